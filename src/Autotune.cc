@@ -0,0 +1,285 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Autotune.hh"
+#include "Global.hh"
+#include "Comm.hh"
+#include "Timer.hh"
+#include "Problem.hh"
+#include "PsiData.hh"
+#include "SweepData.hh"
+#include "SweeperTraverse.hh"
+#include "GraphTraverser.hh"
+#include <omp.h>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+
+static const char *GAUSS_ELIM_NAMES[] = 
+    {"Original", "NoPivot", "CramerGlu", "CramerIntel"};
+
+
+/*
+    Config
+    
+    One point of the search space.
+*/
+struct Config
+{
+    UINT intraAngleP;
+    UINT interAngleP;
+    UINT maxCellsPerStep;
+    GaussElim gaussElim;
+    UINT nThreads;
+};
+
+
+/*
+    getConfig
+*/
+static Config getConfig()
+{
+    Config config;
+    config.intraAngleP = g_intraAngleP;
+    config.interAngleP = g_interAngleP;
+    config.maxCellsPerStep = g_maxCellsPerStep;
+    config.gaussElim = g_gaussElim;
+    config.nThreads = g_nThreads;
+    return config;
+}
+
+
+/*
+    setConfig
+*/
+static void setConfig(const Config &config)
+{
+    g_intraAngleP = config.intraAngleP;
+    g_interAngleP = config.interAngleP;
+    g_maxCellsPerStep = config.maxCellsPerStep;
+    g_gaussElim = config.gaussElim;
+    g_nThreads = config.nThreads;
+    g_nAngleGroups = config.nThreads;
+    omp_set_num_threads(config.nThreads);
+}
+
+
+/*
+    timeSweep
+    
+    Returns the max time over ranks of one SweeperTraverse::sweep with the
+    current configuration.  Priorities and the traverser are set up 
+    outside the timing.
+*/
+static double timeSweep()
+{
+    g_graphTraverserForward = 
+        new GraphTraverser(Direction_Forward, true, 
+                           SweepData::getDataSizeInBytes(g_nGroupBlocks),
+                           g_nGroupBlocks);
+    
+    double time;
+    {
+        SweeperTraverse sweeper;
+        PsiData psi;
+        PsiData source;
+        Problem::getSource(source);
+        psi.setToValue(0.0);
+        
+        Comm::barrier();
+        Timer timer;
+        timer.start();
+        sweeper.sweep(psi, source, false);
+        timer.stop();
+        
+        time = timer.wall_clock();
+        Comm::gmax(time);
+    }
+    
+    delete g_graphTraverserForward;
+    g_graphTraverserForward = NULL;
+    return time;
+}
+
+
+/*
+    printConfig
+*/
+static void printConfig(FILE *file, const Config &config)
+{
+    fprintf(file, "intraAngleP     %" PRIu64 "\n", config.intraAngleP);
+    fprintf(file, "interAngleP     %" PRIu64 "\n", config.interAngleP);
+    fprintf(file, "maxCellsPerStep %" PRIu64 "\n", config.maxCellsPerStep);
+    fprintf(file, "GaussElim       %s\n", GAUSS_ELIM_NAMES[config.gaussElim]);
+}
+
+
+namespace Autotune
+{
+
+/*
+    tune
+    
+    Searches for the fastest TraverseGraph sweep over intraAngleP, 
+    interAngleP, maxCellsPerStep, GaussElim and the number of threads.
+    Each trial is one timed sweep.  The search tunes one parameter at a 
+    time, in that order, keeping the best values found so far for the 
+    others.  maxCellsPerStep is tried at 1/4 to 4 times its input value
+    and threads at powers of 2 up to the number of threads at startup.
+    
+    The best configuration is set in the globals and written by rank 0 
+    to filename as an input deck fragment.
+*/
+void tune(const string &filename)
+{
+    Config best = getConfig();
+    
+    
+    // Candidate values
+    vector<UINT> maxCellsPerStepValues;
+    for (UINT scale : {1, 2, 4}) {
+        maxCellsPerStepValues.push_back(
+            max(best.maxCellsPerStep / scale, (UINT)1));
+        maxCellsPerStepValues.push_back(best.maxCellsPerStep * scale);
+    }
+    sort(maxCellsPerStepValues.begin(), maxCellsPerStepValues.end());
+    maxCellsPerStepValues.erase(unique(maxCellsPerStepValues.begin(), 
+                                       maxCellsPerStepValues.end()), 
+                                maxCellsPerStepValues.end());
+    
+    vector<UINT> nThreadsValues;
+    for (UINT nThreads = 1; nThreads < best.nThreads; nThreads *= 2) {
+        nThreadsValues.push_back(nThreads);
+    }
+    nThreadsValues.push_back(best.nThreads);
+    
+    
+    // Warm up, then time the input configuration
+    if (Comm::rank() == 0)
+        printf("Autotune: warm up\n");
+    timeSweep();
+    double bestTime = timeSweep();
+    
+    
+    // Tune each parameter
+    for (UINT param = 0; param < 5; param++) {
+        
+        vector<Config> trials;
+        Config trial = best;
+        switch (param) {
+            case 0:
+                for (UINT value = 0; value <= 5; value++) {
+                    trial.intraAngleP = value;
+                    trials.push_back(trial);
+                }
+                break;
+            case 1:
+                for (UINT value = 0; value <= 2; value++) {
+                    trial.interAngleP = value;
+                    trials.push_back(trial);
+                }
+                break;
+            case 2:
+                for (UINT value : maxCellsPerStepValues) {
+                    trial.maxCellsPerStep = value;
+                    trials.push_back(trial);
+                }
+                break;
+            case 3:
+                for (GaussElim value : {GaussElim_Original, GaussElim_NoPivot,
+                                        GaussElim_CramerGlu, 
+                                        GaussElim_CramerIntel})
+                {
+                    trial.gaussElim = value;
+                    trials.push_back(trial);
+                }
+                break;
+            case 4:
+                for (UINT value : nThreadsValues) {
+                    trial.nThreads = value;
+                    trials.push_back(trial);
+                }
+                break;
+        }
+        
+        for (const Config &config : trials) {
+            setConfig(config);
+            double time = timeSweep();
+            
+            if (Comm::rank() == 0) {
+                printf("Autotune: intraAngleP %" PRIu64 
+                       "  interAngleP %" PRIu64 
+                       "  maxCellsPerStep %" PRIu64 
+                       "  GaussElim %s  threads %" PRIu64 ": %fs\n",
+                       config.intraAngleP, config.interAngleP, 
+                       config.maxCellsPerStep, 
+                       GAUSS_ELIM_NAMES[config.gaussElim], config.nThreads,
+                       time);
+            }
+            
+            if (time < bestTime) {
+                bestTime = time;
+                best = config;
+            }
+        }
+    }
+    
+    
+    // Use and write the best configuration
+    setConfig(best);
+    if (Comm::rank() == 0) {
+        printf("Autotune: best sweep time %fs with\n", bestTime);
+        printConfig(stdout, best);
+        printf("OMP_NUM_THREADS=%" PRIu64 "\n", best.nThreads);
+        
+        FILE *file = fopen(filename.c_str(), "w");
+        Insist(file != NULL, "Could not open autotune file.");
+        fprintf(file, "# Autotuned for %d ranks: sweep time %fs\n", 
+                Comm::numRanks(), bestTime);
+        fprintf(file, "# Run with OMP_NUM_THREADS=%" PRIu64 "\n", 
+                best.nThreads);
+        printConfig(file, best);
+        fclose(file);
+    }
+}
+
+} // End namespace
@@ -41,6 +41,7 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Assert.hh"
 #include "Global.hh"
 #include <mpi.h>
+#include <string.h>
 
 
 static const int INT_TAG = 1;
@@ -204,11 +205,11 @@ void sendUIntVector(const std::vector<UINT> &buffer, int destination)
     Asynchronous send of int vector for a given tag.
 */
 void iSendUIntVector(const std::vector<UINT> &buffer, int destination, int tag, 
-                     MPI_Request &request)
+                     MPI_Request &request, MPI_Comm comm)
 {
     UINT *buffer1 = const_cast<UINT*>(buffer.data());
     int result = MPI_Isend(buffer1, buffer.size(), MPI_UINT64_T, destination, 
-                           tag, MPI_COMM_WORLD, &request);
+                           tag, comm, &request);
     Insist(result == MPI_SUCCESS, "Comm::iSendUIntVector MPI error.\n");
 }
 
@@ -219,11 +220,11 @@ void iSendUIntVector(const std::vector<UINT> &buffer, int destination, int tag,
     Asynchronous send of double vector for a given tag.
 */
 void iSendDoubleVector(const std::vector<double> &buffer, int destination, 
-                       int tag, MPI_Request &request)
+                       int tag, MPI_Request &request, MPI_Comm comm)
 {
     double *buffer1 = const_cast<double*>(buffer.data());
     int result = MPI_Isend(buffer1, buffer.size(), MPI_DOUBLE, destination, tag, 
-                           MPI_COMM_WORLD, &request);
+                           comm, &request);
     Insist(result == MPI_SUCCESS, "Comm::iSendDoubleVector MPI error.\n");
 }
 
@@ -259,10 +260,11 @@ void recvUIntVector(std::vector<UINT> &buffer, int destination)
     
     Blocking receive of int/double vector for a given tag.
 */
-void recvUIntVector(std::vector<UINT> &buffer, int destination, int tag)
+void recvUIntVector(std::vector<UINT> &buffer, int destination, int tag, 
+                    MPI_Comm comm)
 {
     int result = MPI_Recv(&buffer[0], buffer.size(), MPI_UINT64_T, destination, 
-                          tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                          tag, comm, MPI_STATUS_IGNORE);
     Insist(result == MPI_SUCCESS, "Comm::recvUIntVector with tag MPI error.\n");
 }
 
@@ -272,14 +274,95 @@ void recvUIntVector(std::vector<UINT> &buffer, int destination, int tag)
     
     Blocking receive of int/double vector for a given tag.
 */
-void recvDoubleVector(std::vector<double> &buffer, int destination, int tag)
+void recvDoubleVector(std::vector<double> &buffer, int destination, int tag, 
+                      MPI_Comm comm)
 {
     int result = MPI_Recv(&buffer[0], buffer.size(), MPI_DOUBLE, destination, 
-                          tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                          tag, comm, MPI_STATUS_IGNORE);
     Insist(result == MPI_SUCCESS, "Comm::recvDoubleVector MPI error.\n");
 }
 
 
+/*
+    iSendFloatVector
+
+    Asynchronous send of float vector for a given tag.
+*/
+void iSendFloatVector(const std::vector<float> &buffer, int destination, 
+                      int tag, MPI_Request &request, MPI_Comm comm)
+{
+    float *buffer1 = const_cast<float*>(buffer.data());
+    int result = MPI_Isend(buffer1, buffer.size(), MPI_FLOAT, destination, tag, 
+                           comm, &request);
+    Insist(result == MPI_SUCCESS, "Comm::iSendFloatVector MPI error.\n");
+}
+
+
+/*
+    recvFloatVector
+    
+    Blocking receive of float vector for a given tag.
+*/
+void recvFloatVector(std::vector<float> &buffer, int destination, int tag, 
+                     MPI_Comm comm)
+{
+    int result = MPI_Recv(&buffer[0], buffer.size(), MPI_FLOAT, destination, 
+                          tag, comm, MPI_STATUS_IGNORE);
+    Insist(result == MPI_SUCCESS, "Comm::recvFloatVector MPI error.\n");
+}
+
+
+/*
+    wireRealSize
+    
+    Size in bytes of one psi value sent between ranks.
+    With SinglePrecisionComm psi is sent as float, otherwise as double.
+*/
+UINT wireRealSize()
+{
+    return g_useSinglePrecisionComm ? sizeof(float) : sizeof(double);
+}
+
+
+/*
+    realsToWire
+    
+    Writes numValues doubles to wire in the format sent between ranks.
+*/
+void realsToWire(const double *values, UINT numValues, char *wire)
+{
+    if (g_useSinglePrecisionComm) {
+        for (UINT i = 0; i < numValues; i++) {
+            float value = values[i];
+            memcpy(wire + i * sizeof(float), &value, sizeof(float));
+        }
+    }
+    else {
+        memcpy(wire, values, numValues * sizeof(double));
+    }
+}
+
+
+/*
+    wireToReals
+    
+    Reads numValues doubles from wire (see realsToWire).
+*/
+void wireToReals(const char *wire, UINT numValues, double *values)
+{
+    if (g_useSinglePrecisionComm) {
+        for (UINT i = 0; i < numValues; i++) {
+            float value;
+            memcpy(&value, wire + i * sizeof(float), sizeof(float));
+            values[i] = value;
+        }
+    }
+    else {
+        memcpy(values, wire, numValues * sizeof(double));
+    }
+}
+
+
 /*
     barrier
     
@@ -292,6 +375,107 @@ void barrier()
 }
 
 
+/*
+    pingPongTime
+    
+    Average one-way time of a message of numBytes between ranks rank1 and 
+    rank2.  Only those ranks take part.
+*/
+static
+double pingPongTime(int rank1, int rank2, UINT numBytes, UINT numTrips)
+{
+    std::vector<char> buffer(numBytes);
+    int myRank = rank();
+    int otherRank = (myRank == rank1) ? rank2 : rank1;
+    int tag = 0;
+    int result;
+    
+    double startTime = MPI_Wtime();
+    for (UINT trip = 0; trip < numTrips; trip++) {
+        if (myRank == rank1) {
+            result = MPI_Send(buffer.data(), numBytes, MPI_BYTE, otherRank, 
+                              tag, MPI_COMM_WORLD);
+            Insist(result == MPI_SUCCESS, "Comm::pingPongTime MPI error.\n");
+            result = MPI_Recv(buffer.data(), numBytes, MPI_BYTE, otherRank, 
+                              tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            Insist(result == MPI_SUCCESS, "Comm::pingPongTime MPI error.\n");
+        }
+        else {
+            result = MPI_Recv(buffer.data(), numBytes, MPI_BYTE, otherRank, 
+                              tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            Insist(result == MPI_SUCCESS, "Comm::pingPongTime MPI error.\n");
+            result = MPI_Send(buffer.data(), numBytes, MPI_BYTE, otherRank, 
+                              tag, MPI_COMM_WORLD);
+            Insist(result == MPI_SUCCESS, "Comm::pingPongTime MPI error.\n");
+        }
+    }
+    
+    return (MPI_Wtime() - startTime) / (2 * numTrips);
+}
+
+
+/*
+    measureLatencyBandwidth
+    
+    Measures the message latency (seconds) and bandwidth (bytes/second)
+    with a ping-pong between the first and last rank, fitting 
+    time = latency + bytes / bandwidth to a small and a large message.
+    All ranks get the result.  With one rank, both are 0.
+*/
+void measureLatencyBandwidth(double &latency, double &bandwidth)
+{
+    const UINT smallBytes = 8;
+    const UINT largeBytes = 1 << 20;
+    const UINT numSmallTrips = 1000;
+    const UINT numLargeTrips = 20;
+    int rank1 = 0;
+    int rank2 = numRanks() - 1;
+    double values[2] = {0.0, 0.0};
+    
+    if (rank1 != rank2 && (rank() == rank1 || rank() == rank2)) {
+        
+        // Warm up the connection
+        pingPongTime(rank1, rank2, largeBytes, 1);
+        
+        double smallTime = 
+            pingPongTime(rank1, rank2, smallBytes, numSmallTrips);
+        double largeTime = 
+            pingPongTime(rank1, rank2, largeBytes, numLargeTrips);
+        
+        values[0] = smallTime;
+        if (largeTime > smallTime)
+            values[1] = (largeBytes - smallBytes) / (largeTime - smallTime);
+    }
+    
+    int result = MPI_Bcast(values, 2, MPI_DOUBLE, rank1, MPI_COMM_WORLD);
+    Insist(result == MPI_SUCCESS, "Comm::measureLatencyBandwidth MPI error.\n");
+    latency = values[0];
+    bandwidth = values[1];
+}
+
+
+/*
+    createNeighborComm
+    
+    Creates a distributed graph communicator for neighborhood collectives.
+    The neighbors are adjRanks (ranks in MPI_COMM_WORLD) in the same order.
+    MPI may renumber the ranks to better fit the machine.
+    Collective over MPI_COMM_WORLD.
+*/
+MPI_Comm createNeighborComm(const std::vector<UINT> &adjRanks)
+{
+    std::vector<int> neighbors(adjRanks.begin(), adjRanks.end());
+    MPI_Comm neighborComm;
+    int reorder = 1;
+    int result = MPI_Dist_graph_create_adjacent(
+        MPI_COMM_WORLD, neighbors.size(), neighbors.data(), MPI_UNWEIGHTED, 
+        neighbors.size(), neighbors.data(), MPI_UNWEIGHTED, MPI_INFO_NULL, 
+        reorder, &neighborComm);
+    Insist(result == MPI_SUCCESS, "Comm::createNeighborComm MPI error.\n");
+    return neighborComm;
+}
+
+
 /*
     openFileForRead
 
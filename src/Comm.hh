@@ -61,16 +61,33 @@ void gmax(UINT &x);
 void sendUInt(UINT i, int destination);
 void sendUIntVector(const std::vector<UINT> &buffer, int destination);
 void iSendUIntVector(const std::vector<UINT> &buffer, int destination, 
-                     int tag, MPI_Request &request);
+                     int tag, MPI_Request &request, 
+                     MPI_Comm comm = MPI_COMM_WORLD);
 void iSendDoubleVector(const std::vector<double> &buffer, int destination, 
-                       int tag, MPI_Request &request);
+                       int tag, MPI_Request &request, 
+                       MPI_Comm comm = MPI_COMM_WORLD);
 
 void recvUInt(UINT &i, int destination);
 void recvUIntVector(std::vector<UINT> &buffer, int destination);
-void recvUIntVector(std::vector<UINT> &buffer, int destination, int tag);
-void recvDoubleVector(std::vector<double> &buffer, int destination, int tag);
+void recvUIntVector(std::vector<UINT> &buffer, int destination, int tag, 
+                    MPI_Comm comm = MPI_COMM_WORLD);
+void recvDoubleVector(std::vector<double> &buffer, int destination, int tag, 
+                      MPI_Comm comm = MPI_COMM_WORLD);
+
+void iSendFloatVector(const std::vector<float> &buffer, int destination, 
+                      int tag, MPI_Request &request, 
+                      MPI_Comm comm = MPI_COMM_WORLD);
+void recvFloatVector(std::vector<float> &buffer, int destination, int tag, 
+                     MPI_Comm comm = MPI_COMM_WORLD);
+
+UINT wireRealSize();
+void realsToWire(const double *values, UINT numValues, char *wire);
+void wireToReals(const char *wire, UINT numValues, double *values);
 
 void barrier();
+void measureLatencyBandwidth(double &latency, double &bandwidth);
+
+MPI_Comm createNeighborComm(const std::vector<UINT> &adjRanks);
 
 void openFileForRead(const std::string &filename, MPI_File &file);
 void openFileForWrite(const std::string &filename, MPI_File &file);
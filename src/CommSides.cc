@@ -39,16 +39,76 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "CommSides.hh"
 #include "Global.hh"
 #include "Comm.hh"
+#include "NodeBuffers.hh"
+#include "NodeAggregator.hh"
 #include <vector>
 #include <algorithm>
-#include <string.h>
+#include <limits>
+#include <thread>
+#include <omp.h>
+#include <cstring>
+#include <cmath>
+
+
+static const UINT NO_REQUEST = std::numeric_limits<UINT>::max();
+
+
+/*
+    getDataSize
+
+    Returns data size of 1 cell/face of data to send.
+*/
+static UINT getDataSize()
+{
+    return g_nGroups * g_nVrtxPerFace * Comm::wireRealSize();
+}
+
+
+/*
+    getBitmapSize
+
+    Returns bytes in the bitmap of changed packets of a delta message.
+*/
+static UINT getBitmapSize(UINT numPackets)
+{
+    return (numPackets + 7) / 8;
+}
+
+
+/*
+    packPacket
+    
+    Writes psi for (cell, face, angle) to packet using faceData as scratch.
+*/
+static void packPacket(UINT cell, UINT face, UINT angle, const PsiData &psi, 
+                       std::vector<double> &faceData, char *packet)
+{
+    for (UINT group = 0; group < g_nGroups; group++) {
+    for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+        UINT vrtx = g_tychoMesh->getFaceToCellVrtx(cell, face, fvrtx);
+        faceData[fvrtx + g_nVrtxPerFace * group] = 
+            psi(group, vrtx, angle, cell);
+    }}
+    
+    Comm::realsToWire(faceData.data(), faceData.size(), packet);
+}
 
 
 /*
     Constructor
+    
+    Packets are psi only.  Both ranks sharing a face order the packets 
+    between them by (global side, angle), so the receiver knows the 
+    (side, angle) of each packet without a header.
+    
+    The packet buffers and the MPI requests (persistent) are created once 
+    and reused by every call to commSides.
 */
 CommSides::CommSides()
 {
+    int mpiError;
+    
+    
     // Get adjacent ranks
     for (UINT cell = 0; cell < g_nCells; cell++) {
     for (UINT face = 0; face < g_nFacePerCell; face++) {
@@ -63,17 +123,17 @@ CommSides::CommSides()
             c_adjRanks.push_back(adjRank);
         }
     }}
+    UINT numAdjRanks = c_adjRanks.size();
     
     
-    // Populate sendMetaData, numSendPackets, and numRecvPackets
-    c_sendMetaData.resize(c_adjRanks.size());
-    c_numSendPackets.resize(c_adjRanks.size());
-    c_numRecvPackets.resize(c_adjRanks.size());
+    // Populate sendMetaData, recvMetaData, numSendPackets, and 
+    // numRecvPackets
+    c_sendMetaData.resize(numAdjRanks);
+    c_recvMetaData.resize(numAdjRanks);
+    c_numSendPackets.resize(numAdjRanks);
+    c_numRecvPackets.resize(numAdjRanks);
     
-    for (UINT rankIndex = 0; rankIndex < c_adjRanks.size(); rankIndex++) {
-        
-        c_numSendPackets[rankIndex] = 0;
-        c_numRecvPackets[rankIndex] = 0;
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
         
         for (UINT cell = 0; cell < g_nCells; cell++) {
         for (UINT face = 0; face < g_nFacePerCell; face++) {
@@ -81,166 +141,720 @@ CommSides::CommSides()
             UINT adjRank = g_tychoMesh->getAdjRank(cell, face);        
             if (adjRank == c_adjRanks[rankIndex]) {
                 for (UINT angle = 0; angle < g_nAngles; angle++) {
-                    if (g_tychoMesh->isOutgoing(angle, cell, face)) {
-                        CommSides::MetaData md;
-                        UINT side = g_tychoMesh->getSide(cell, face);
-                        md.gSide = g_tychoMesh->getLGSide(side);
-                        md.angle = angle;
-                        md.cell  = cell;
-                        md.face  = face;
+                    CommSides::MetaData md;
+                    UINT side = g_tychoMesh->getSide(cell, face);
+                    md.gSide = g_tychoMesh->getLGSide(side);
+                    md.angle = angle;
+                    md.cell  = cell;
+                    md.face  = face;
+                    if (g_tychoMesh->isOutgoing(angle, cell, face))
                         c_sendMetaData[rankIndex].push_back(md);
-                        
-                        c_numSendPackets[rankIndex]++;
-                    }
-                    else {
-                        c_numRecvPackets[rankIndex]++;
-                    }
+                    else
+                        c_recvMetaData[rankIndex].push_back(md);
                 }
             }
         }}
+        
+        auto lessThan = [](const MetaData &md1, const MetaData &md2) {
+            return md1.gSide < md2.gSide || 
+                   (md1.gSide == md2.gSide && md1.angle < md2.angle);
+        };
+        std::sort(c_sendMetaData[rankIndex].begin(), 
+                  c_sendMetaData[rankIndex].end(), lessThan);
+        std::sort(c_recvMetaData[rankIndex].begin(), 
+                  c_recvMetaData[rankIndex].end(), lessThan);
+        
+        c_numSendPackets[rankIndex] = c_sendMetaData[rankIndex].size();
+        c_numRecvPackets[rankIndex] = c_recvMetaData[rankIndex].size();
+    }
+    
+    
+    // Communicator for neighborhood collectives
+    if (g_useNeighborCollectives) {
+        c_neighborComm = Comm::createNeighborComm(c_adjRanks);
+    }
+    
+    
+    // Node shared memory for adjacent ranks on the same node
+    c_nodeBuffers = NULL;
+    c_numExchanges = 0;
+    if (g_useSharedMemoryComm) {
+        std::vector<UINT> recvSizes(numAdjRanks);
+        for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+            recvSizes[rankIndex] = c_numRecvPackets[rankIndex] * getDataSize();
+        }
+        c_nodeBuffers = new NodeBuffers(c_adjRanks, recvSizes);
+    }
+    
+    
+    // Two-level exchange through node leaders
+    c_nodeAggregator = NULL;
+    if (g_useNodeAggregation) {
+        c_nodeAggregator = new NodeAggregator(c_adjRanks, 
+                                              g_nodeAggregationRanksPerNode);
+    }
+    
+    
+    // Packet buffers for MPI
+    c_sendBuffers.resize(numAdjRanks);
+    c_recvBuffers.resize(numAdjRanks);
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        if (c_nodeBuffers != NULL && c_nodeBuffers->onNode(rankIndex))
+            continue;
+        c_sendBuffers[rankIndex].resize(
+            c_numSendPackets[rankIndex] * getDataSize());
+        c_recvBuffers[rankIndex].resize(
+            c_numRecvPackets[rankIndex] * getDataSize());
+    }
+    
+    
+    // Delta messages
+    // The send buffers hold the packets as last sent and the recv buffers 
+    // the packets as last received, so both start as psi = 0.
+    c_deltaSendMessages.resize(numAdjRanks);
+    c_deltaRecvMessages.resize(numAdjRanks);
+    c_deltaSendSizes.resize(numAdjRanks, 0);
+    c_numPacketsSent = 0;
+    c_numPacketsTotal = 0;
+    if (g_useDeltaComm) {
+        for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+            if (c_sendBuffers[rankIndex].size() > 0) {
+                c_deltaSendMessages[rankIndex].resize(
+                    getBitmapSize(c_numSendPackets[rankIndex]) + 
+                    c_sendBuffers[rankIndex].size());
+            }
+            if (c_recvBuffers[rankIndex].size() > 0) {
+                c_deltaRecvMessages[rankIndex].resize(
+                    getBitmapSize(c_numRecvPackets[rankIndex]) + 
+                    c_recvBuffers[rankIndex].size());
+            }
+        }
+    }
+    
+    
+    // Persistent requests for point-to-point messages
+    c_sendRequestIndex.resize(numAdjRanks, NO_REQUEST);
+    if (!g_useNeighborCollectives && c_nodeAggregator == NULL && 
+        !g_useDeltaComm)
+    {
+        for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+            int tag = 0;
+            int adjRank = c_adjRanks[rankIndex];
+            MPI_Request request;
+            
+            if (c_recvBuffers[rankIndex].size() > 0) {
+                mpiError = MPI_Recv_init(c_recvBuffers[rankIndex].data(), 
+                                         c_recvBuffers[rankIndex].size(), 
+                                         MPI_BYTE, adjRank, tag, 
+                                         MPI_COMM_WORLD, &request);
+                Insist(mpiError == MPI_SUCCESS, "");
+                c_recvRequests.push_back(request);
+                c_recvRequestRankIndex.push_back(rankIndex);
+            }
+            
+            if (c_sendBuffers[rankIndex].size() > 0) {
+                mpiError = MPI_Send_init(c_sendBuffers[rankIndex].data(), 
+                                         c_sendBuffers[rankIndex].size(), 
+                                         MPI_BYTE, adjRank, tag, 
+                                         MPI_COMM_WORLD, &request);
+                Insist(mpiError == MPI_SUCCESS, "");
+                c_sendRequestIndex[rankIndex] = c_sendRequests.size();
+                c_sendRequests.push_back(request);
+            }
+        }
+        c_requestIndices.resize(c_recvRequests.size());
+    }
+    
+    
+    // Data to stream sends
+    c_sideRankIndex.resize(g_tychoMesh->getNSides(), 
+                           std::numeric_limits<UINT>::max());
+    c_sendPacketIndex.resize(g_tychoMesh->getNSides(), g_nAngles);
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        for (UINT packetIndex = 0; 
+             packetIndex < c_sendMetaData[rankIndex].size(); packetIndex++)
+        {
+            const MetaData &md = c_sendMetaData[rankIndex][packetIndex];
+            UINT side = g_tychoMesh->getSide(md.cell, md.face);
+            c_sideRankIndex[side] = rankIndex;
+            c_sendPacketIndex(side, md.angle) = packetIndex;
+        }
+    }
+    c_numSidesLeft.resize(numAdjRanks, 0);
+    c_sendStarted.resize(numAdjRanks, false);
+    c_numSendsStarted = 0;
+    c_localFaceData.resize(g_nThreads);
+    for (UINT thread = 0; thread < g_nThreads; thread++) {
+        c_localFaceData[thread].resize(g_nVrtxPerFace * g_nGroups);
     }
 }
 
 
 /*
-    getDataSize
+    Destructor
+*/
+CommSides::~CommSides()
+{
+    for (MPI_Request &request : c_recvRequests) {
+        MPI_Request_free(&request);
+    }
+    for (MPI_Request &request : c_sendRequests) {
+        MPI_Request_free(&request);
+    }
+    if (g_useNeighborCollectives) {
+        MPI_Comm_free(&c_neighborComm);
+    }
+    if (c_nodeBuffers != NULL) {
+        delete c_nodeBuffers;
+    }
+    if (c_nodeAggregator != NULL) {
+        delete c_nodeAggregator;
+    }
+}
 
-    Returns data size of 1 cell/face of data to send.
+
+/*
+    packSides
+    
+    Writes psi for the packets to adjacent rank index rankIndex to buffer.
+    The packets are gathered in parallel.
 */
-static UINT getDataSize()
+void CommSides::packSides(UINT rankIndex, const PsiData &psi, char *buffer)
 {
-    return g_nGroups * g_nVrtxPerFace * sizeof(double);
+    const std::vector<MetaData> &metaData = c_sendMetaData[rankIndex];
+    UINT dataSize = getDataSize();
+    
+    #pragma omp parallel
+    {
+        std::vector<double> faceData(g_nVrtxPerFace * g_nGroups);
+        
+        #pragma omp for schedule(static)
+        for (UINT packetIndex = 0; packetIndex < metaData.size(); 
+             packetIndex++)
+        {
+            packPacket(metaData[packetIndex].cell, metaData[packetIndex].face,
+                       metaData[packetIndex].angle, psi, faceData, 
+                       &buffer[packetIndex * dataSize]);
+        }
+    }
+}
+
+
+/*
+    unpackSides
+    
+    Puts the packets from adjacent rank index rankIndex into psiBound.
+*/
+void CommSides::unpackSides(UINT rankIndex, const char *buffer, 
+                            PsiBoundData &psiBound)
+{
+    const std::vector<MetaData> &metaData = c_recvMetaData[rankIndex];
+    UINT dataSize = getDataSize();
+    
+    #pragma omp parallel
+    {
+        std::vector<double> faceData(g_nVrtxPerFace * g_nGroups);
+        
+        #pragma omp for schedule(static)
+        for (UINT packetIndex = 0; packetIndex < metaData.size(); 
+             packetIndex++)
+        {
+            UINT angle = metaData[packetIndex].angle;
+            UINT side = g_tychoMesh->getSide(metaData[packetIndex].cell, 
+                                             metaData[packetIndex].face);
+            
+            Comm::wireToReals(&buffer[packetIndex * dataSize], 
+                              faceData.size(), faceData.data());
+            
+            for (UINT group = 0; group < g_nGroups; group++) {
+            for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+                psiBound(group, fvrtx, angle, side) = 
+                    faceData[fvrtx + g_nVrtxPerFace * group];
+            }}
+        }
+    }
 }
 
 
 /*
     commSides
+    
+    Sends psi on the outgoing boundary sides and puts the incoming 
+    boundary psi into psiBound.
 */
 void CommSides::commSides(PsiData &psi, PsiBoundData &psiBound)
+{
+    startSides();
+    
+    for (UINT rankIndex = 0; rankIndex < c_adjRanks.size(); rankIndex++) {
+        if (c_sendRequestIndex[rankIndex] != NO_REQUEST) {
+            packSides(rankIndex, psi, c_sendBuffers[rankIndex].data());
+            c_numSidesLeft[rankIndex] = 0;
+        }
+    }
+    
+    finishSides(psi, psiBound);
+}
+
+
+/*
+    startSides
+    
+    Starts an exchange.  Between startSides and finishSides, the sweep 
+    computing psi calls putSide for each outgoing boundary (side, angle) 
+    when its psi is done.  The send to an adjacent rank starts as soon as 
+    all its packets are put.
+    
+    Only the point-to-point sends are streamed.  Delta messages, node 
+    aggregation, neighborhood collectives and node shared memory exchange 
+    everything in finishSides.
+*/
+void CommSides::startSides()
 {
     int mpiError;
-    UINT numToRecv;
-    UINT numAdjRanks = c_adjRanks.size();
-    UINT packetSize = 2 * sizeof(UINT) + getDataSize();
-    std::vector<MPI_Request> mpiRecvRequests(numAdjRanks);
-    std::vector<MPI_Request> mpiSendRequests(numAdjRanks);
-    std::vector<std::vector<char>> dataToSend(numAdjRanks);
-    std::vector<std::vector<char>> dataToRecv(numAdjRanks);
-    Mat2<double> localFaceData(g_nVrtxPerFace, g_nGroups);
     
+    if (c_recvRequests.size() > 0) {
+        mpiError = MPI_Startall(c_recvRequests.size(), c_recvRequests.data());
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
     
-    // Data structures to send/recv packets
-    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
-        dataToSend[rankIndex].resize(packetSize * c_numSendPackets[rankIndex]);
-        dataToRecv[rankIndex].resize(packetSize * c_numRecvPackets[rankIndex]);
+    for (UINT rankIndex = 0; rankIndex < c_adjRanks.size(); rankIndex++) {
+        c_numSidesLeft[rankIndex] = c_numSendPackets[rankIndex];
+        c_sendStarted[rankIndex] = false;
     }
+    c_numSendsStarted = 0;
+    c_recvsArrived.clear();
+}
+
+
+/*
+    putSide
     
+    Packs psi for the outgoing boundary (side, angle).
+    Can be called by any thread.
+*/
+void CommSides::putSide(UINT side, UINT angle, const PsiData &psi)
+{
+    UINT rankIndex = c_sideRankIndex[side];
+    Assert(rankIndex < c_adjRanks.size());
+    if (c_sendRequestIndex[rankIndex] == NO_REQUEST)
+        return;
     
-    // Irecv data
-    numToRecv = 0;
-    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+    UINT packetIndex = c_sendPacketIndex(side, angle);
+    const MetaData &md = c_sendMetaData[rankIndex][packetIndex];
+    packPacket(md.cell, md.face, md.angle, psi, 
+               c_localFaceData[omp_get_thread_num()],
+               &c_sendBuffers[rankIndex][packetIndex * getDataSize()]);
+    
+    // seq_cst orders the packed packet before the decrement, so the master
+    // thread cannot start the send before the packet is written
+    #pragma omp atomic update seq_cst
+    c_numSidesLeft[rankIndex]--;
+}
+
+
+/*
+    progressSides
+    
+    Starts the sends whose packets are all put and records the recvs that
+    have arrived.  Only call from the master thread (MPI_THREAD_FUNNELED).
+*/
+void CommSides::progressSides()
+{
+    int mpiError;
+    
+    startReadySends();
+    
+    if (c_recvsArrived.size() < c_recvRequests.size()) {
+        int numArrived;
+        mpiError = MPI_Testsome(c_recvRequests.size(), c_recvRequests.data(),
+                                &numArrived, c_requestIndices.data(), 
+                                MPI_STATUSES_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
         
-        if (dataToRecv[rankIndex].size() > 0) {
-            int tag = 0;
-            int adjRank = c_adjRanks[rankIndex];
-            MPI_Request request;
-            mpiError = MPI_Irecv(dataToRecv[rankIndex].data(), 
-                                 dataToRecv[rankIndex].size(), 
-                                 MPI_BYTE, adjRank, tag, MPI_COMM_WORLD,
-                                 &request);
+        for (int i = 0; i < numArrived; i++) {
+            c_recvsArrived.push_back(
+                c_recvRequestRankIndex[c_requestIndices[i]]);
+        }
+    }
+}
+
+
+/*
+    startReadySends
+    
+    Starts the sends not yet started whose packets are all put.
+*/
+void CommSides::startReadySends()
+{
+    int mpiError;
+    
+    if (c_numSendsStarted == c_sendRequests.size())
+        return;
+    
+    for (UINT rankIndex = 0; rankIndex < c_adjRanks.size(); rankIndex++) {
+        
+        UINT requestIndex = c_sendRequestIndex[rankIndex];
+        if (requestIndex == NO_REQUEST || c_sendStarted[rankIndex])
+            continue;
+        
+        // seq_cst pairs with the decrement in putSide
+        UINT numSidesLeft;
+        #pragma omp atomic read seq_cst
+        numSidesLeft = c_numSidesLeft[rankIndex];
+        
+        if (numSidesLeft == 0) {
+            mpiError = MPI_Start(&c_sendRequests[requestIndex]);
             Insist(mpiError == MPI_SUCCESS, "");
-            mpiRecvRequests[rankIndex] = request;
-            numToRecv++;
+            c_sendStarted[rankIndex] = true;
+            c_numSendsStarted++;
+        }
+    }
+}
+
+
+/*
+    finishSides
+    
+    Finishes the exchange and puts the incoming boundary psi into psiBound.
+    psiBound is only written here, so a sweep streaming its outgoing psi 
+    still reads the incoming psi of the previous exchange.
+    
+    With neighborhood collectives, all the data is exchanged in one 
+    MPI_Neighbor_alltoallw since the sizes are known in advance.
+    
+    With node shared memory, packets for adjacent ranks on this node are 
+    written directly into their memory instead.  Each call is numbered.
+    The packets of a call are written once the adjacent rank has read 
+    those of the previous call, and read once the adjacent rank has written
+    those of this call.
+*/
+void CommSides::finishSides(PsiData &psi, PsiBoundData &psiBound)
+{
+    int mpiError;
+    UINT numAdjRanks = c_adjRanks.size();
+    
+    
+    // Start the remaining sends
+    startReadySends();
+    Insist(c_numSendsStarted == c_sendRequests.size(), 
+           "Outgoing boundary psi not all put.");
+    
+    
+    // Write data to adjacent ranks on this node
+    if (c_nodeBuffers != NULL) {
+        c_numExchanges++;
+        for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+            
+            if (!c_nodeBuffers->onNode(rankIndex) || 
+                c_numSendPackets[rankIndex] == 0)
+            {
+                continue;
+            }
+            
+            while (c_nodeBuffers->getNumRead(rankIndex) != c_numExchanges - 1)
+                std::this_thread::yield();
+            
+            packSides(rankIndex, psi, c_nodeBuffers->sendBuffer(rankIndex));
+            c_nodeBuffers->putNumWritten(rankIndex, c_numExchanges);
+        }
+    }
+    
+    
+    // Exchange only the packets that changed
+    if (g_useDeltaComm) {
+        exchangeDeltas(psi, psiBound);
+    }
+    
+    
+    // Exchange data through node leaders
+    else if (c_nodeAggregator != NULL) {
+        for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+            if (c_sendBuffers[rankIndex].size() > 0)
+                packSides(rankIndex, psi, c_sendBuffers[rankIndex].data());
         }
         
-        else {
-            mpiRecvRequests[rankIndex] = MPI_REQUEST_NULL;
+        c_nodeAggregator->exchange(c_sendBuffers, c_recvBuffers);
+        
+        for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+            Assert(c_recvBuffers[rankIndex].size() == 
+                   c_numRecvPackets[rankIndex] * getDataSize());
+            if (c_recvBuffers[rankIndex].size() > 0)
+                unpackSides(rankIndex, c_recvBuffers[rankIndex].data(), 
+                            psiBound);
         }
     }
     
     
-    // Update data to send and Isend it
-    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+    // Exchange data with neighborhood collective
+    // Buffers are given by absolute address relative to MPI_BOTTOM
+    else if (g_useNeighborCollectives) {
+        std::vector<int> sendCounts(numAdjRanks);
+        std::vector<int> recvCounts(numAdjRanks);
+        std::vector<MPI_Aint> sendDispls(numAdjRanks, 0);
+        std::vector<MPI_Aint> recvDispls(numAdjRanks, 0);
+        std::vector<MPI_Datatype> types(numAdjRanks, MPI_BYTE);
         
-        if (dataToSend[rankIndex].size() > 0) {
-            for (UINT metaDataIndex = 0; 
-                 metaDataIndex < c_sendMetaData[rankIndex].size(); 
-                 metaDataIndex++)
+        for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+            sendCounts[rankIndex] = c_sendBuffers[rankIndex].size();
+            recvCounts[rankIndex] = c_recvBuffers[rankIndex].size();
+            if (sendCounts[rankIndex] > 0) {
+                packSides(rankIndex, psi, c_sendBuffers[rankIndex].data());
+                MPI_Get_address(c_sendBuffers[rankIndex].data(), 
+                                &sendDispls[rankIndex]);
+            }
+            if (recvCounts[rankIndex] > 0)
+                MPI_Get_address(c_recvBuffers[rankIndex].data(), 
+                                &recvDispls[rankIndex]);
+        }
+        
+        mpiError = MPI_Neighbor_alltoallw(
+            MPI_BOTTOM, sendCounts.data(), sendDispls.data(), types.data(), 
+            MPI_BOTTOM, recvCounts.data(), recvDispls.data(), types.data(), 
+            c_neighborComm);
+        Insist(mpiError == MPI_SUCCESS, "");
+        
+        for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+            if (c_recvBuffers[rankIndex].size() > 0)
+                unpackSides(rankIndex, c_recvBuffers[rankIndex].data(), 
+                            psiBound);
+        }
+    }
+    
+    
+    // Read data from adjacent ranks on this node
+    // The packets are unpacked in place.
+    if (c_nodeBuffers != NULL) {
+        for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+            
+            if (!c_nodeBuffers->onNode(rankIndex) || 
+                c_numRecvPackets[rankIndex] == 0)
             {
-                UINT gSide = c_sendMetaData[rankIndex][metaDataIndex].gSide;
-                UINT angle = c_sendMetaData[rankIndex][metaDataIndex].angle;
-                UINT cell  = c_sendMetaData[rankIndex][metaDataIndex].cell;
-                UINT face  = c_sendMetaData[rankIndex][metaDataIndex].face;
-                
-                for (UINT group = 0; group < g_nGroups; group++) {
-                for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
-                    UINT vrtx = g_tychoMesh->getFaceToCellVrtx(cell, face, fvrtx);
-                    localFaceData(fvrtx, group) = psi(group, vrtx, angle, cell);
-                }}
-
-                const char *data = (char*) (&localFaceData[0]);
-                
-                char *ptr = &dataToSend[rankIndex][metaDataIndex * packetSize];
-                memcpy(ptr, &gSide, sizeof(UINT));
-                ptr += sizeof(UINT);
-                memcpy(ptr, &angle, sizeof(UINT));
-                ptr += sizeof(UINT);
-                memcpy(ptr, data, getDataSize());
+                continue;
             }
             
-            int tag = 0;
-            int adjRank = c_adjRanks[rankIndex];
+            while (c_nodeBuffers->getNumWritten(rankIndex) != c_numExchanges)
+                std::this_thread::yield();
+            
+            unpackSides(rankIndex, c_nodeBuffers->recvBuffer(rankIndex), 
+                        psiBound);
+            c_nodeBuffers->putNumRead(rankIndex, c_numExchanges);
+        }
+    }
+    
+    
+    // Get data from recvs that arrived during the sweep, then the rest
+    // Completed persistent requests become inactive and are skipped.
+    for (UINT rankIndex : c_recvsArrived) {
+        unpackSides(rankIndex, c_recvBuffers[rankIndex].data(), psiBound);
+    }
+    
+    for (UINT numWaits = c_recvsArrived.size(); 
+         numWaits < c_recvRequests.size(); numWaits++)
+    {
+        int requestIndex;
+        mpiError = MPI_Waitany(c_recvRequests.size(), c_recvRequests.data(), 
+                               &requestIndex, MPI_STATUS_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
+        
+        UINT rankIndex = c_recvRequestRankIndex[requestIndex];
+        unpackSides(rankIndex, c_recvBuffers[rankIndex].data(), psiBound);
+    }
+    
+    
+    // Wait on send to complete
+    if (c_sendRequests.size() > 0) {
+        mpiError = MPI_Waitall(c_sendRequests.size(), c_sendRequests.data(), 
+                               MPI_STATUSES_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+}
+
+
+/*
+    exchangeDeltas
+    
+    Sends each adjacent rank only the packets whose psi changed by more 
+    than DeltaCommFactor * DD_ErrMax relative to the packet's largest 
+    value since they were last sent.  The receiver keeps the packets it 
+    last received in c_recvBuffers, so psiBound gets every packet.
+    
+    As the PBJ iteration converges, fewer packets change and the messages
+    shrink.  A packet is off by at most the threshold, which is below the 
+    convergence tolerance.
+*/
+void CommSides::exchangeDeltas(const PsiData &psi, PsiBoundData &psiBound)
+{
+    int mpiError;
+    int tag = 0;
+    UINT numAdjRanks = c_adjRanks.size();
+    std::vector<MPI_Request> recvRequests;
+    std::vector<MPI_Request> sendRequests;
+    std::vector<UINT> recvRankIndices;
+    
+    
+    // Post recvs
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        if (c_deltaRecvMessages[rankIndex].size() > 0) {
             MPI_Request request;
-            mpiError = MPI_Isend(dataToSend[rankIndex].data(), 
-                                 dataToSend[rankIndex].size(), 
-                                 MPI_BYTE, adjRank, tag, MPI_COMM_WORLD, 
-                                 &request);
+            mpiError = MPI_Irecv(c_deltaRecvMessages[rankIndex].data(), 
+                                 c_deltaRecvMessages[rankIndex].size(), 
+                                 MPI_BYTE, c_adjRanks[rankIndex], tag, 
+                                 MPI_COMM_WORLD, &request);
             Insist(mpiError == MPI_SUCCESS, "");
-            mpiSendRequests[rankIndex] = request;
+            recvRequests.push_back(request);
+            recvRankIndices.push_back(rankIndex);
         }
-        
-        else {
-            mpiSendRequests[rankIndex] = MPI_REQUEST_NULL;
+    }
+    
+    
+    // Send changed packets
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        if (c_deltaSendMessages[rankIndex].size() > 0) {
+            MPI_Request request;
+            packDeltas(rankIndex, psi);
+            mpiError = MPI_Isend(c_deltaSendMessages[rankIndex].data(), 
+                                 c_deltaSendSizes[rankIndex], MPI_BYTE, 
+                                 c_adjRanks[rankIndex], tag, MPI_COMM_WORLD,
+                                 &request);
+            Insist(mpiError == MPI_SUCCESS, "");
+            sendRequests.push_back(request);
         }
     }
     
     
-    // Get data from Irecv
-    for (UINT numWaits = 0; numWaits < numToRecv; numWaits++) {
-        
-        // Wait for a data packet to arrive
-        int rankIndex;
-        mpiError = MPI_Waitany(mpiRecvRequests.size(), mpiRecvRequests.data(), 
-                               &rankIndex, MPI_STATUS_IGNORE);
+    // Update the recv buffers as they arrive
+    for (UINT numWaits = 0; numWaits < recvRequests.size(); numWaits++) {
+        int requestIndex;
+        mpiError = MPI_Waitany(recvRequests.size(), recvRequests.data(), 
+                               &requestIndex, MPI_STATUS_IGNORE);
         Insist(mpiError == MPI_SUCCESS, "");
         
+        UINT rankIndex = recvRankIndices[requestIndex];
+        unpackDeltas(rankIndex);
+        unpackSides(rankIndex, c_recvBuffers[rankIndex].data(), psiBound);
+    }
+    
+    
+    // Wait on sends to complete
+    if (sendRequests.size() > 0) {
+        mpiError = MPI_Waitall(sendRequests.size(), sendRequests.data(), 
+                               MPI_STATUSES_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+}
+
+
+/*
+    packDeltas
+    
+    Writes the delta message for adjacent rank index rankIndex: a bitmap of
+    the changed packets followed by those packets in order.  The changed 
+    packets are found in parallel and copied to c_sendBuffers.
+*/
+void CommSides::packDeltas(UINT rankIndex, const PsiData &psi)
+{
+    const std::vector<MetaData> &metaData = c_sendMetaData[rankIndex];
+    std::vector<char> &lastSent = c_sendBuffers[rankIndex];
+    std::vector<char> &message = c_deltaSendMessages[rankIndex];
+    UINT numPackets = metaData.size();
+    UINT dataSize = getDataSize();
+    UINT numValues = g_nVrtxPerFace * g_nGroups;
+    double threshold = g_deltaCommFactor * g_ddErrMax;
+    std::vector<char> changed(numPackets);
+    
+    #pragma omp parallel
+    {
+        std::vector<double> faceData(numValues);
+        std::vector<double> newData(numValues);
+        std::vector<double> oldData(numValues);
+        std::vector<char> packet(dataSize);
         
-        // Process Data
-        UINT numPackets = dataToRecv[rankIndex].size() / packetSize;
+        #pragma omp for schedule(static)
         for (UINT packetIndex = 0; packetIndex < numPackets; packetIndex++) {
-            char *ptr = &dataToRecv[rankIndex][packetIndex * packetSize];
-            UINT gSide = 0;
-            UINT angle = 0;
-            memcpy(&gSide, ptr, sizeof(UINT));
-            ptr += sizeof(UINT);
-            memcpy(&angle, ptr, sizeof(UINT));
-            ptr += sizeof(UINT);
-            UINT side = g_tychoMesh->getGLSide(gSide);
-
-            localFaceData.setData((double*)ptr);
-            for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
-            for (UINT group = 0; group < g_nGroups; group++) {
-                psiBound(group, fvrtx, angle, side) = localFaceData(fvrtx, group);
-            }}
+            char *oldPacket = &lastSent[packetIndex * dataSize];
+            packPacket(metaData[packetIndex].cell, metaData[packetIndex].face,
+                       metaData[packetIndex].angle, psi, faceData, 
+                       packet.data());
+            Comm::wireToReals(packet.data(), numValues, newData.data());
+            Comm::wireToReals(oldPacket, numValues, oldData.data());
+            
+            double maxDiff = 0.0;
+            double maxValue = 0.0;
+            for (UINT i = 0; i < numValues; i++) {
+                maxDiff = std::max(maxDiff, fabs(newData[i] - oldData[i]));
+                maxValue = std::max(maxValue, fabs(newData[i]));
+            }
+            
+            changed[packetIndex] = maxDiff > threshold * maxValue;
+            if (changed[packetIndex])
+                memcpy(oldPacket, packet.data(), dataSize);
         }
     }
     
     
-    // Wait on send to complete
-    if (mpiSendRequests.size() > 0) {
-        mpiError = MPI_Waitall(mpiSendRequests.size(), mpiSendRequests.data(), 
-                               MPI_STATUSES_IGNORE);
-        Insist(mpiError == MPI_SUCCESS, "");
+    // Bitmap and changed packets
+    UINT bitmapSize = getBitmapSize(numPackets);
+    UINT messageSize = bitmapSize;
+    memset(message.data(), 0, bitmapSize);
+    for (UINT packetIndex = 0; packetIndex < numPackets; packetIndex++) {
+        if (changed[packetIndex]) {
+            message[packetIndex / 8] |= (char)(1 << (packetIndex % 8));
+            memcpy(&message[messageSize], &lastSent[packetIndex * dataSize],
+                   dataSize);
+            messageSize += dataSize;
+            c_numPacketsSent++;
+        }
     }
+    c_deltaSendSizes[rankIndex] = messageSize;
+    c_numPacketsTotal += numPackets;
 }
 
+
+/*
+    unpackDeltas
+    
+    Copies the changed packets in the delta message from adjacent rank 
+    index rankIndex to c_recvBuffers.
+*/
+void CommSides::unpackDeltas(UINT rankIndex)
+{
+    const std::vector<char> &message = c_deltaRecvMessages[rankIndex];
+    std::vector<char> &lastRecv = c_recvBuffers[rankIndex];
+    UINT numPackets = c_numRecvPackets[rankIndex];
+    UINT dataSize = getDataSize();
+    UINT messageIndex = getBitmapSize(numPackets);
+    
+    for (UINT packetIndex = 0; packetIndex < numPackets; packetIndex++) {
+        if (message[packetIndex / 8] & (1 << (packetIndex % 8))) {
+            memcpy(&lastRecv[packetIndex * dataSize], &message[messageIndex],
+                   dataSize);
+            messageIndex += dataSize;
+        }
+    }
+    Assert(messageIndex <= message.size());
+}
+
+
+/*
+    printStats
+    
+    Prints the fraction of packets sent as deltas over all calls so far.
+*/
+void CommSides::printStats()
+{
+    if (!g_useDeltaComm)
+        return;
+    
+    UINT numPacketsSent = c_numPacketsSent;
+    UINT numPacketsTotal = c_numPacketsTotal;
+    Comm::gsum(numPacketsSent);
+    Comm::gsum(numPacketsTotal);
+    
+    if (Comm::rank() == 0) {
+        printf("Delta comm: sent %" PRIu64 " of %" PRIu64 " packets "
+               "(%.1f%%)\n", numPacketsSent, numPacketsTotal, 
+               numPacketsTotal == 0 ? 0.0 : 
+               100.0 * numPacketsSent / numPacketsTotal);
+    }
+}
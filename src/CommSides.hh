@@ -36,6 +36,8 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "PsiData.hh"
+#include "Mat.hh"
+#include <mpi.h>
 #include <vector>
 
 
@@ -43,13 +45,34 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #define __COMMSIDES_HH__
 
 
+class NodeBuffers;
+class NodeAggregator;
+
+
 class CommSides
 {
 public:
     CommSides();
+    ~CommSides();
     void commSides(PsiData &psi, PsiBoundData &psiBound);
+    
+    // Streaming version of commSides for a sweep that computes psi
+    void startSides();
+    void putSide(UINT side, UINT angle, const PsiData &psi);
+    void progressSides();
+    void finishSides(PsiData &psi, PsiBoundData &psiBound);
+    
+    void printStats();
 
 private:
+    void packSides(UINT rankIndex, const PsiData &psi, char *buffer);
+    void unpackSides(UINT rankIndex, const char *buffer, 
+                     PsiBoundData &psiBound);
+    void startReadySends();
+    void exchangeDeltas(const PsiData &psi, PsiBoundData &psiBound);
+    void packDeltas(UINT rankIndex, const PsiData &psi);
+    void unpackDeltas(UINT rankIndex);
+    
     struct MetaData
     {
         UINT gSide;
@@ -60,8 +83,34 @@ private:
 
     std::vector<UINT> c_adjRanks;
     std::vector<std::vector<CommSides::MetaData>> c_sendMetaData;
+    std::vector<std::vector<CommSides::MetaData>> c_recvMetaData;
     std::vector<UINT> c_numSendPackets;
     std::vector<UINT> c_numRecvPackets;
+    MPI_Comm c_neighborComm;
+    NodeBuffers *c_nodeBuffers;     // NULL if not used
+    NodeAggregator *c_nodeAggregator;   // NULL if not used
+    UINT c_numExchanges;            // Calls to commSides using c_nodeBuffers
+    std::vector<std::vector<char>> c_sendBuffers;   // Empty if on node
+    std::vector<std::vector<char>> c_recvBuffers;   // Empty if on node
+    std::vector<MPI_Request> c_sendRequests;        // Persistent
+    std::vector<MPI_Request> c_recvRequests;        // Persistent
+    std::vector<UINT> c_recvRequestRankIndex;       // request -> rankIndex
+    std::vector<int> c_requestIndices;      // Completed requests (Testsome)
+    std::vector<UINT> c_sendRequestIndex;   // rankIndex -> request or NO_REQUEST
+    std::vector<UINT> c_sideRankIndex;      // side -> rankIndex
+    Mat2<UINT> c_sendPacketIndex;           // (side, angle) -> packet index
+    std::vector<UINT> c_numSidesLeft;       // rankIndex -> packets not put
+    std::vector<bool> c_sendStarted;        // rankIndex -> send started
+    UINT c_numSendsStarted;
+    std::vector<UINT> c_recvsArrived;       // rankIndex of arrived recvs
+    std::vector<std::vector<double>> c_localFaceData;   // Per thread
+    std::vector<std::vector<char>> c_deltaSendMessages; // rankIndex -> message
+    std::vector<std::vector<char>> c_deltaRecvMessages; // rankIndex -> message
+    std::vector<UINT> c_deltaSendSizes;     // rankIndex -> bytes in message
+    UINT c_numPacketsSent;                  // Changed packets sent
+    UINT c_numPacketsTotal;                 // All packets that would be sent
+                                            // without DeltaComm (denominator
+                                            // of the printed ratio)
 };
 
 #endif
@@ -87,7 +87,8 @@ enum SweepType
     SweepType_Schur,
     SweepType_SchurOuter,
     SweepType_PBJSI,
-    SweepType_SchurKrylov
+    SweepType_SchurKrylov,
+    SweepType_TraverseLevels
 };
 
 enum GaussElim
@@ -111,6 +112,7 @@ EXTERN std::vector<double> g_sigmaS;
 EXTERN UINT g_maxCellsPerStep;
 EXTERN UINT g_intraAngleP;
 EXTERN UINT g_interAngleP;
+EXTERN UINT g_priorityLatencyCost;
 EXTERN SweepType g_sweepType;
 EXTERN TychoMesh *g_tychoMesh;
 EXTERN SweepSchedule **g_sweepSchedule;
@@ -125,6 +127,26 @@ EXTERN double g_ddErrMax;
 EXTERN UINT g_ddIterMax;
 EXTERN bool g_useSourceIteration;
 EXTERN bool g_useOneSidedMPI;
+EXTERN UINT g_patchSize;
+EXTERN bool g_adaptiveCellsPerStep;
+EXTERN UINT g_nGroupBlocks;
+EXTERN UINT g_nSources;
+EXTERN bool g_useCommThread;
+EXTERN bool g_useNeighborCollectives;
+EXTERN UINT g_oneSidedRingSize;
+EXTERN bool g_useSharedMemoryComm;
+EXTERN bool g_useSinglePrecisionComm;
+EXTERN bool g_coalesceMessages;
+EXTERN UINT g_coalesceBytes;
+EXTERN double g_coalesceDeadline;
+EXTERN bool g_useNodeAggregation;
+EXTERN UINT g_nodeAggregationRanksPerNode;
+EXTERN bool g_useDeltaComm;
+EXTERN double g_deltaCommFactor;
+EXTERN std::string g_scheduleCache;
+EXTERN bool g_autotune;
+EXTERN std::string g_autotuneFilename;
+EXTERN bool g_useStarvationHints;
 
 #endif
 
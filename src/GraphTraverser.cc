@@ -43,17 +43,32 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "TychoMesh.hh"
 #include "Comm.hh"
 #include "Timer.hh"
+#include "SweepData.hh"
+#include "PriorityData.hh"
+#include "NodeBuffers.hh"
+#include "NodeAggregator.hh"
 #include <vector>
-#include <set>
 #include <queue>
 #include <utility>
 #include <omp.h>
 #include <limits.h>
 #include <string.h>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <chrono>
 
 using namespace std;
 
 
+// Adaptive step size stays within this factor of maxComputePerStep
+static const UINT ADAPTIVE_STEP_FACTOR = 8;
+
+// No starvation hint in a data size message
+static const UINT NO_HINT = UINT64_MAX;
+
+
 /*
     Tuple class
 */
@@ -81,42 +96,268 @@ public:
 };}
 
 
+/*
+    CommBuffers
+    
+    Buffers used to communicate in each step of a traversal.
+    They are created at the start of the traversal and reused every step,
+    so once they have grown the traversal loop does not allocate memory.
+    
+    sendBuffers(angleGroup)(rankIndex) are written directly by the compute
+    threads and sent without gathering them into one buffer.
+    For adjacent ranks on the same node (NodeBuffers), they are copied 
+    straight into the adjacent rank's memory instead.
+    sideRecv holds the (side, angle) pairs received in the step.
+*/
+namespace {
+struct CommBuffers
+{
+    CommBuffers(UINT numAngleGroups, UINT numAdjRanks)
+    : sendBuffers(numAngleGroups, vector<vector<char>>(numAdjRanks)),
+      recvBuffers(numAdjRanks), recvSizes(numAdjRanks), 
+      sendSizes(numAdjRanks), recvRequests(numAdjRanks), 
+      blockLengths(numAngleGroups), displacements(numAngleGroups),
+      completedIndices(numAdjRanks),
+      nodeSendPositions(numAdjRanks), nodeRecvPositions(numAdjRanks),
+      sendCounts(numAdjRanks), recvCounts(numAdjRanks), 
+      sendDispls(numAdjRanks), recvDispls(numAdjRanks), 
+      sendTypes(numAdjRanks), recvTypes(numAdjRanks), 
+      doneRequest(MPI_REQUEST_NULL), localDone(0), allDone(0),
+      holdSend(numAdjRanks, 0), pendingSince(numAdjRanks, -1.0),
+      sendHeaders(2 * numAdjRanks), recvHeaders(2 * numAdjRanks),
+      sendHints(numAdjRanks, NO_HINT), lastSentHints(numAdjRanks, NO_HINT),
+      numHintOnlySent(0)
+    {
+        sendRequests.reserve(2 * numAdjRanks);
+    }
+    
+    // Total number of bytes to send to the adjacent rank
+    UINT sendSize(UINT rankIndex) const
+    {
+        UINT size = 0;
+        for (UINT angleGroup = 0; angleGroup < sendBuffers.size(); 
+             angleGroup++) 
+        {
+            size += sendBuffers[angleGroup][rankIndex].size();
+        }
+        return size;
+    }
+    
+    // Clear send buffers (keeps their memory)
+    // Buffers held for coalescing are kept for a later step.
+    void clearSendBuffers()
+    {
+        for (auto &angleGroupBuffers : sendBuffers) {
+            for (UINT rankIndex = 0; rankIndex < angleGroupBuffers.size(); 
+                 rankIndex++) 
+            {
+                if (!holdSend[rankIndex])
+                    angleGroupBuffers[rankIndex].clear();
+            }
+        }
+    }
+    
+    vector<vector<vector<char>>> sendBuffers;
+    vector<vector<char>> recvBuffers;
+    vector<pair<UINT,UINT>> sideRecv;
+    vector<UINT> recvSizes;
+    vector<UINT> sendSizes;
+    vector<MPI_Request> recvRequests;
+    vector<MPI_Request> sendRequests;
+    vector<int> blockLengths;
+    vector<MPI_Aint> displacements;
+    vector<int> completedIndices;
+    vector<UINT> numSendPackets;
+    vector<UINT> numSendRemaining;
+    vector<UINT> numRecvRemaining;
+    
+    // Packets written to/read from node shared memory in the traversal
+    vector<UINT> nodeSendPositions;
+    vector<UINT> nodeRecvPositions;
+    
+    // Used with neighborhood collectives
+    vector<int> sendCounts;
+    vector<int> recvCounts;
+    vector<MPI_Aint> sendDispls;
+    vector<MPI_Aint> recvDispls;
+    vector<MPI_Datatype> sendTypes;
+    vector<MPI_Datatype> recvTypes;
+    MPI_Request doneRequest;
+    int localDone;
+    int allDone;
+    
+    // Used with CoalesceMessages
+    vector<char> holdSend;          // rankIndex -> send kept for later
+    vector<double> pendingSince;    // rankIndex -> MPI_Wtime of oldest 
+                                    // held data, < 0 if none
+    
+    // Used with StarvationHints
+    // The data size message is (size, hint) instead of size.
+    vector<UINT> sendHeaders;       // 2 * rankIndex -> (size, hint)
+    vector<UINT> recvHeaders;       // 2 * rankIndex -> (size, hint)
+    vector<UINT> sendHints;         // rankIndex -> hint or NO_HINT
+    vector<pair<UINT,UINT>> recvHints;  // (rankIndex, hint) recv in the call
+    vector<UINT> lastSentHints;     // rankIndex -> last hint sent
+    UINT numHintOnlySent;           // Hints sent without data
+};}
+
+
+/*
+    StarvationHints
+    
+    State of the starvation hints (StarvationHints option) in a traversal.
+    
+    When a rank is about to run out of work, it adds a hint to the data it 
+    sends to each adjacent rank it still waits on: the index (as in a 
+    packet) of the most urgent (side, angle) pair it needs from that rank.
+    The adjacent rank boosts the (cell, angle) pairs upstream of that side,
+    so they are computed before the other pairs in its queues.
+    
+    Boosted seeds that are ready go on the urgent queue of their angle 
+    group, which is emptied before canCompute.  The priority of an entry in
+    a priority_queue cannot be changed, so a boosted seed may also still be
+    in canCompute.  isDone is used to skip the second copy.
+*/
+struct StarvationHints
+{
+    StarvationHints(UINT nBlockAngles, UINT numCells, UINT numAngleGroups, 
+                    UINT numAdjRanks)
+    : isDone(nBlockAngles, numCells), isBoosted(nBlockAngles, numCells),
+      urgent(numAngleGroups), recvOrder(numAdjRanks), 
+      recvCursor(numAdjRanks, 0), isRecv(numAdjRanks), 
+      numRecv(0), numBoosted(0)
+    { }
+    
+    Mat2<char> isDone;      // (blockAngle, seed) -> taken from a queue
+    Mat2<char> isBoosted;   // (blockAngle, seed) -> goes on urgent queue
+    vector<priority_queue<Tuple>> urgent;
+    vector<vector<UINT>> recvOrder; // rankIndex -> indices of packets to 
+                                    // recv, most urgent first
+    vector<UINT> recvCursor;        // rankIndex -> first index in recvOrder
+                                    // that may not be received
+    vector<vector<char>> isRecv;    // (rankIndex, index) -> received
+    UINT numRecv;
+    UINT numBoosted;
+};
+
+
+/*
+    Packets
+    
+    Packet is (index, data)
+    Both ranks sharing a side order the shared sides by global side, so the
+    (side, angle) pair is sent as one index into that ordering:
+    index = sideIndex * nBlockAngles + angle
+    The index is a full UINT so the data stays aligned for doubles.
+*/
+static
+UINT packetSize(UINT dataSize)
+{
+    return sizeof(UINT) + dataSize;
+}
+
+
 /*
     splitPacket
     
-    Packet is (global side, angle, data)
+    Returns the local side and angle of the packet using commSides.
 */
 static
-void splitPacket(char *packet, UINT &globalSide, UINT &angle, char **data)
+void splitPacket(char *packet, const vector<UINT> &commSides, 
+                 UINT nBlockAngles, UINT &side, UINT &angle, char **data)
 {
-    memcpy(&globalSide, packet, sizeof(UINT));
-    packet += sizeof(UINT);
-    memcpy(&angle, packet, sizeof(UINT));
+    UINT index;
+    memcpy(&index, packet, sizeof(UINT));
     packet += sizeof(UINT);
+    side = commSides[index / nBlockAngles];
+    angle = index % nBlockAngles;
     *data = packet;
 }
 
 
 /*
-    createPacket
+    appendPacket
     
-    Packet is (global side, angle, data)
+    The packet is written at the end of buffer.
 */
 static
-void createPacket(vector<char> &packet, UINT globalSide, UINT angle, 
-                  UINT dataSize, const char *data)
+void appendPacket(vector<char> &buffer, UINT index, UINT dataSize, 
+                  const char *data)
 {
-    packet.resize(2 * sizeof(UINT) + dataSize);
-    char *p = packet.data();
+    UINT offset = buffer.size();
+    buffer.resize(offset + packetSize(dataSize));
+    char *p = &buffer[offset];
     
-    memcpy(p, &globalSide, sizeof(UINT));
-    p += sizeof(UINT);
-    memcpy(p, &angle, sizeof(UINT));
+    memcpy(p, &index, sizeof(UINT));
     p += sizeof(UINT);
     memcpy(p, data, dataSize);
 }
 
 
+/*
+    unpackPackets
+    
+    Sets the side data for each packet received from adjacent rank 
+    rankIndex and records the (side, angle) pairs in sideRecv.
+*/
+static
+void unpackPackets(char *packets, UINT numPackets, UINT packetSizeInBytes,
+                   const vector<UINT> &commSides, UINT nBlockAngles, 
+                   TraverseData &traverseData, 
+                   vector<pair<UINT,UINT>> &sideRecv)
+{
+    for (UINT i = 0; i < numPackets; i++) {
+        char *packet = &packets[i * packetSizeInBytes];
+        UINT localSide;
+        UINT angle;
+        char *packetData;
+        splitPacket(packet, commSides, nBlockAngles, 
+                    localSide, angle, &packetData);
+        
+        traverseData.setSideData(localSide, angle, packetData);
+        sideRecv.push_back(make_pair(localSide, angle));
+    }
+}
+
+
+/*
+    createSendType
+    
+    Returns a committed datatype describing the (nonempty) angle group 
+    send buffers for adjacent rank rankIndex by their absolute addresses.
+    Used with MPI_BOTTOM, so the buffers are sent in place as one message.
+*/
+static
+MPI_Datatype createSendType(CommBuffers &commBuffers, UINT rankIndex)
+{
+    int mpiError;
+    int numBlocks = 0;
+    MPI_Datatype sendType;
+    
+    for (const auto &angleGroupBuffers : commBuffers.sendBuffers) {
+        const vector<char> &sendBuffer = angleGroupBuffers[rankIndex];
+        if (sendBuffer.size() == 0)
+            continue;
+        
+        Assert(sendBuffer.size() < INT_MAX);
+        commBuffers.blockLengths[numBlocks] = sendBuffer.size();
+        mpiError = MPI_Get_address(sendBuffer.data(), 
+                                   &commBuffers.displacements[numBlocks]);
+        Insist(mpiError == MPI_SUCCESS, "");
+        numBlocks++;
+    }
+    
+    mpiError = MPI_Type_create_hindexed(
+        numBlocks, commBuffers.blockLengths.data(), 
+        commBuffers.displacements.data(), MPI_BYTE, &sendType);
+    Insist(mpiError == MPI_SUCCESS, "");
+    mpiError = MPI_Type_commit(&sendType);
+    Insist(mpiError == MPI_SUCCESS, "");
+    
+    return sendType;
+}
+
+
 /*
     isIncoming
     
@@ -176,422 +417,717 @@ UINT angleGroupIndex(UINT angle)
 
 
 /*
-    sendData
-
-    Implements one-sided MPI for sending data.
+    calcSfcKeys
+    
+    Calculates a Morton (Z-order) space-filling curve key for each cell
+    from the cell centroid.
 */
-static 
-void sendData(const vector<vector<char>> &sendBuffers,
-              const vector<UINT> &adjRankIndexToRank,
-              const vector<UINT> &offRankOffsets,
-              const UINT packetSizeInBytes,
-              const UINT maxPackets,
-              const MPI_Win &mpiWin,
-              const bool firstTime)
+static
+void calcSfcKeys(vector<UINT> &sfcKeys)
 {
-    // Internal state with number of packets written for each data chunk
-    // and the current data chunk to write to for each adjacent rank.
-    static vector<uint32_t> numPacketsWrittenVector[2];
-    static vector<uint32_t> currentDataChunkVector;
-    UINT numAdjRanks = adjRankIndexToRank.size();
-    if (firstTime) {
-        numPacketsWrittenVector[0].clear();
-        numPacketsWrittenVector[1].clear();
-        currentDataChunkVector.clear();
-
-        numPacketsWrittenVector[0].resize(numAdjRanks);
-        numPacketsWrittenVector[1].resize(numAdjRanks);
-        currentDataChunkVector.resize(numAdjRanks);
+    const UINT bitsPerDim = 10;
+    const UINT maxCoord = (1 << bitsPerDim) - 1;
+    Mat2<double> centroids(g_nCells, g_ndim);
+    double lowCoord[g_ndim];
+    double highCoord[g_ndim];
+    
+    
+    // Centroids and bounding box
+    for (UINT dim = 0; dim < g_ndim; dim++) {
+        lowCoord[dim] = numeric_limits<double>::max();
+        highCoord[dim] = numeric_limits<double>::lowest();
     }
     
-
-    // Send data to each adjacent rank
-    for (UINT index = 0; index < numAdjRanks; index++) {
-        
-        // Make sure there is data to send
-        if (sendBuffers[index].size() == 0)
-            continue;
-        
-
-        // Useful values
-        int mpiError;
-        int adjRank = adjRankIndexToRank[index];
-        UINT offRankOffset = offRankOffsets[index];
-        const vector<char> &sendBuffer = sendBuffers[index];
-        uint32_t currentDataChunk = currentDataChunkVector[index];
-        uint32_t numPacketsWritten = 
-            numPacketsWrittenVector[currentDataChunk][index];
-        
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT dim = 0; dim < g_ndim; dim++) {
+        centroids(cell, dim) = 0.0;
+        for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
+            UINT node = g_tychoMesh->getCellNode(cell, vrtx);
+            centroids(cell, dim) += g_tychoMesh->getNodeCoord(node, dim);
+        }
+        centroids(cell, dim) /= g_nVrtxPerCell;
+        lowCoord[dim] = min(lowCoord[dim], centroids(cell, dim));
+        highCoord[dim] = max(highCoord[dim], centroids(cell, dim));
+    }}
+    
+    
+    // Interleave bits of the scaled coordinates
+    sfcKeys.resize(g_nCells);
+    for (UINT cell = 0; cell < g_nCells; cell++) {
         
-        // Check to see if there is NOT room to write data in current data chunk
-        UINT numPacketsToSend = sendBuffer.size() / packetSizeInBytes;
-        if (numPacketsWritten + numPacketsToSend > maxPackets) {
-            
-            // Flag indicating we can't write to this data chunk anymore
-            // Must be removed by recvData
-            uint32_t one = 1;
-            UINT offset = offRankOffset + 4 * currentDataChunk;
-            mpiError = MPI_Accumulate(&one, 1, MPI_UINT32_T, adjRank, offset, 
-                                      1, MPI_UINT32_T, MPI_REPLACE, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
-            
-            
-            // change data chunk we're working on
-            numPacketsWrittenVector[currentDataChunk][index] = 0;
-            numPacketsWritten = 0;
-            currentDataChunk = (currentDataChunk + 1) % 2;
-            currentDataChunkVector[index] = currentDataChunk;
-            
-
-            // Spin wait for availability to write to new data chunk
-            while (true) {
-                uint32_t dummy = 0;
-                uint32_t writable = 1;
-                UINT offset = offRankOffset + 4 * currentDataChunk;
-                mpiError = MPI_Fetch_and_op(&dummy, &writable, MPI_UINT32_T,
-                                            adjRank, offset, MPI_NO_OP, mpiWin);
-                Insist(mpiError == MPI_SUCCESS, "");
-                
-                mpiError = MPI_Win_flush_local(adjRank, mpiWin);
-                Insist(mpiError == MPI_SUCCESS, "");
-
-                if (writable == 0)
-                    break;
-            }
+        UINT coords[g_ndim];
+        for (UINT dim = 0; dim < g_ndim; dim++) {
+            double width = highCoord[dim] - lowCoord[dim];
+            double x = (width > 0.0) ? 
+                       (centroids(cell, dim) - lowCoord[dim]) / width : 0.0;
+            coords[dim] = (UINT) (x * maxCoord);
         }
-
-
-        // Write the data
-        UINT offset = offRankOffset + 16 + 
-                      maxPackets * packetSizeInBytes * currentDataChunk + 
-                      numPacketsWritten * packetSizeInBytes;
-        mpiError = MPI_Put(sendBuffer.data(), sendBuffer.size(), 
-                           MPI_BYTE, adjRank, offset, 
-                           sendBuffer.size(), MPI_BYTE, mpiWin);
-        Insist(mpiError == MPI_SUCCESS, "");
-        mpiError = MPI_Win_flush(adjRank, mpiWin);
-        Insist(mpiError == MPI_SUCCESS, "");
         
-
-        // Update number of packets written
-        numPacketsWritten += numPacketsToSend;
-        offset = offRankOffset + 8 + 4 * currentDataChunk;
-        mpiError = MPI_Accumulate(&numPacketsWritten, 1, MPI_UINT32_T, adjRank, 
-                                  offset, 1, MPI_UINT32_T, MPI_REPLACE, mpiWin);
-        Insist(mpiError == MPI_SUCCESS, "");
-        numPacketsWrittenVector[currentDataChunk][index] = numPacketsWritten;
-
-
-        // Flush window for local variables
-        mpiError = MPI_Win_flush_local(adjRank, mpiWin);
-        Insist(mpiError == MPI_SUCCESS, "");
+        sfcKeys[cell] = 0;
+        for (UINT bit = 0; bit < bitsPerDim; bit++) {
+        for (UINT dim = 0; dim < g_ndim; dim++) {
+            UINT b = (coords[dim] >> bit) & 1;
+            sfcKeys[cell] |= b << (g_ndim * bit + dim);
+        }}
     }
 }
 
 
 /*
-    recvData
+    One-sided MPI ring buffers
+
+    Each rank's window has a slot for each adjacent rank containing
+    (packets written, packets read, ring buffer).
+    The adjacent rank puts packets into the ring buffer of its slot and then
+    sets packets written.  After reading them, this rank sets packets read in
+    the slot for this rank in the adjacent rank's window.  So packets read in
+    a slot of a rank's own window is the credit the adjacent rank has given
+    back, and the space left in the adjacent rank's ring buffer is
+    ringSize - (packets sent - packets read).
+    
+    The counts never decrease, so the ring position is count % ringSize.
+    Packets that do not fit are kept in a backlog and sent in a later step,
+    so a sender never waits on the receiver.
+*/
+static const UINT RING_WRITTEN_OFFSET = 0;
+static const UINT RING_READ_OFFSET = 8;
+static const UINT RING_DATA_OFFSET = 16;
+
+// Backoff in microseconds while draining a backlog into a full ring
+static const UINT MIN_DRAIN_BACKOFF = 1;
+static const UINT MAX_DRAIN_BACKOFF = 1000;
 
-    Implements one-sided MPI for receiving data.
+
+/*
+    fetchCount
+    
+    Atomically reads a ring counter in this rank's window.
 */
 static
-void recvData(const UINT numAdjRanks,
-              const vector<UINT> &onRankOffsets,
-              const UINT packetSizeInBytes,
-              TraverseData &traverseData, 
-              set<pair<UINT,UINT>> &sideRecv,
-              const UINT maxPackets,
-              const MPI_Win &mpiWin,
-              const bool firstTime)
+UINT fetchCount(const UINT offset, const MPI_Win &mpiWin)
 {
-    // Initial setup of number of internal state
-    static vector<uint32_t> numPacketsReadVector[2];
-    static vector<uint32_t> headerDataVector;
-    static vector<uint32_t> currentDataChunkVector;
-    if (firstTime) {
-        numPacketsReadVector[0].clear();
-        numPacketsReadVector[1].clear();
-        headerDataVector.clear();
-        currentDataChunkVector.clear();
-
-        numPacketsReadVector[0].resize(numAdjRanks);
-        numPacketsReadVector[1].resize(numAdjRanks);
-        headerDataVector.resize(4 * numAdjRanks);
-        currentDataChunkVector.resize(numAdjRanks);
-    }
+    int mpiError;
+    int myRank = Comm::rank();
+    UINT dummy = 0;
+    UINT count;
     
+    mpiError = MPI_Fetch_and_op(&dummy, &count, MPI_UINT64_T, myRank, offset, 
+                                MPI_NO_OP, mpiWin);
+    Insist(mpiError == MPI_SUCCESS, "");
+    mpiError = MPI_Win_flush_local(myRank, mpiWin);
+    Insist(mpiError == MPI_SUCCESS, "");
     
-    // Useful values
-    int myRank = Comm::rank();
-    int mpiError;
-
+    return count;
+}
 
-    // Get header data for each adjacent rank
-    for (UINT index = 0; index < numAdjRanks; index++) {
 
-        UINT onRankOffset = onRankOffsets[index];
-        uint32_t dummy[4];
-        mpiError = MPI_Get_accumulate(dummy, 4, MPI_UINT32_T, 
-                                      &headerDataVector[4*index], 4, 
-                                      MPI_UINT32_T, myRank, onRankOffset, 4, 
-                                      MPI_UINT32_T, MPI_NO_OP, mpiWin);
-        Insist(mpiError == MPI_SUCCESS, "");
-    }
+/*
+    putCount
+    
+    Atomically sets a ring counter in an adjacent rank's window.
+*/
+static
+void putCount(const UINT count, const int rank, const UINT offset, 
+              const MPI_Win &mpiWin)
+{
+    int mpiError;
+    
+    mpiError = MPI_Accumulate(&count, 1, MPI_UINT64_T, rank, offset, 
+                              1, MPI_UINT64_T, MPI_REPLACE, mpiWin);
+    Insist(mpiError == MPI_SUCCESS, "");
+    mpiError = MPI_Win_flush(rank, mpiWin);
+    Insist(mpiError == MPI_SUCCESS, "");
+}
 
 
-    // Make sure we have the header data
-    mpiError = MPI_Win_flush_local(myRank, mpiWin);
+/*
+    postSizeRecv
+    
+    Posts the recv of the next data size from adjacent rank index.
+    With StarvationHints, a hint is received after the data size.
+*/
+static
+void postSizeRecv(CommBuffers &commBuffers, 
+                  const vector<UINT> &adjRankIndexToRank, UINT index)
+{
+    int adjRank = adjRankIndexToRank[index];
+    int tag0 = 0;
+    int headerSize = g_useStarvationHints ? 2 : 1;
+    int mpiError = MPI_Irecv(&commBuffers.recvHeaders[2 * index], headerSize, 
+                             MPI_UINT64_T, adjRank, tag0, MPI_COMM_WORLD, 
+                             &commBuffers.recvRequests[index]);
     Insist(mpiError == MPI_SUCCESS, "");
+}
 
 
-    // Recv data from each adjacent rank
-    for (UINT index = 0; index < numAdjRanks; index++) {
+/*
+    startSendAndRecvData
     
-        // Useful values
-        UINT onRankOffset = onRankOffsets[index];
-        uint32_t currentDataChunk = currentDataChunkVector[index];
-        uint32_t numPacketsRead = 
-            numPacketsReadVector[currentDataChunk][index];
-        uint32_t numPacketsWritten = 
-            headerDataVector[4 * index + 2 + currentDataChunk];
-
-        
-        // Read packets
-        UINT numPacketsToRecv = numPacketsWritten - numPacketsRead;
-        if (numPacketsToRecv > 0) {
-            
-            // Get data packets
-            UINT dataSizeInBytes = numPacketsToRecv * packetSizeInBytes;
-            UINT offset = onRankOffset + 16 +
-                          maxPackets * packetSizeInBytes * currentDataChunk + 
-                          numPacketsRead * packetSizeInBytes;
-            vector<char> dataPackets(dataSizeInBytes);
-
-            mpiError = MPI_Get(dataPackets.data(), dataSizeInBytes, 
-                               MPI_BYTE, myRank, offset, dataSizeInBytes, 
-                               MPI_BYTE, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
-            mpiError = MPI_Win_flush_local(myRank, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
-            
-            
-            // Unpack packets
-            for (UINT i = 0; i < numPacketsToRecv; i++) {
-                char *packet = &dataPackets[i * packetSizeInBytes];
-                UINT globalSide;
-                UINT angle;
-                char *packetData;
-                splitPacket(packet, globalSide, angle, &packetData);
-                
-                UINT localSide = g_tychoMesh->getGLSide(globalSide);
-                traverseData.setSideData(localSide, angle, packetData);
-                sideRecv.insert(make_pair(localSide,angle));
-            }
+    Sets the number of packets to send to and recv from each adjacent rank
+    in the traversal and posts the first recvs of data sizes.
+*/
+static
+void startSendAndRecvData(CommBuffers &commBuffers, 
+                          const vector<UINT> &adjRankIndexToRank, 
+                          const vector<UINT> &numSendPackets,
+                          const vector<UINT> &numRecvPackets,
+                          NodeBuffers *nodeBuffers)
+{
+    UINT numAdjRanks = adjRankIndexToRank.size();
+    commBuffers.numSendPackets = numSendPackets;
+    commBuffers.numSendRemaining = numSendPackets;
+    commBuffers.numRecvRemaining = numRecvPackets;
+    
+    for (UINT index = 0; index < numAdjRanks; index++) {
+        commBuffers.holdSend[index] = 0;
+        commBuffers.pendingSince[index] = -1.0;
+        commBuffers.lastSentHints[index] = NO_HINT;
+        commBuffers.nodeSendPositions[index] = 0;
+        commBuffers.nodeRecvPositions[index] = 0;
+        commBuffers.recvRequests[index] = MPI_REQUEST_NULL;
+        if (nodeBuffers != NULL && nodeBuffers->onNode(index))
+            continue;
+        if (commBuffers.numRecvRemaining[index] > 0)
+            postSizeRecv(commBuffers, adjRankIndexToRank, index);
+    }
+}
 
 
-            // Update numPacketsRead
-            numPacketsReadVector[currentDataChunk][index] = numPacketsWritten;
-        }
+/*
+    recvNodeData
     
+    Unpacks the packets adjacent ranks on this node have written to this 
+    rank's memory since the last call.  They are unpacked in place.
+    Returns the number of packets received and whether any of these 
+    adjacent ranks still owe packets.
     
-        // Check to see if we need to move to other data chunk
-        if (headerDataVector[4 * index + currentDataChunk] == 1) {
-            
-            // Make sure all reads are completely done
-            mpiError = MPI_Win_flush(myRank, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
-            
-            // Set numWritten to zero
-            uint32_t zero1 = 0;
-            UINT offset = onRankOffset + 8 + 4 * currentDataChunk;
-            mpiError = MPI_Accumulate(&zero1, 1, MPI_UINT32_T, myRank, offset, 
-                                      1, MPI_UINT32_T, MPI_REPLACE, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
-
-            // Set writable bit for this data chunk back to zero
-            uint32_t zero2 = 0;
-            offset = onRankOffset + 4 * currentDataChunk;
-            mpiError = MPI_Accumulate(&zero2, 1, MPI_UINT32_T, myRank, offset, 
-                                      1, MPI_UINT32_T, MPI_REPLACE, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
-            mpiError = MPI_Win_flush_local(myRank, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
+    Once all packets from a rank have been read, its count is reset for the
+    next traversal.  That rank cannot write again before then, since each
+    traversal ends with collectives (the timer reductions) that this rank 
+    only reaches after receiving everything.
+*/
+static
+UINT recvNodeData(CommBuffers &commBuffers, 
+                  NodeBuffers &nodeBuffers,
+                  TraverseData &traverseData, 
+                  const UINT dataSizeInBytes, 
+                  const vector<vector<UINT>> &commSides,
+                  const UINT nBlockAngles,
+                  bool &dataOwed)
+{
+    UINT packetSizeInBytes = packetSize(dataSizeInBytes);
+    UINT numAdjRanks = commBuffers.recvBuffers.size();
+    UINT numRecv = 0;
+    dataOwed = false;
+    
+    for (UINT index = 0; index < numAdjRanks; index++) {
+        
+        if (!nodeBuffers.onNode(index) || 
+            commBuffers.numRecvRemaining[index] == 0)
+        {
+            continue;
+        }
+        
+        UINT &position = commBuffers.nodeRecvPositions[index];
+        UINT numWritten = nodeBuffers.getNumWritten(index);
+        UINT numPackets = numWritten - position;
+        Assert(numPackets <= commBuffers.numRecvRemaining[index]);
+        
+        if (numPackets > 0) {
+            char *packets = 
+                nodeBuffers.recvBuffer(index) + position * packetSizeInBytes;
+            unpackPackets(packets, numPackets, packetSizeInBytes, 
+                          commSides[index], nBlockAngles, traverseData, 
+                          commBuffers.sideRecv);
+            position = numWritten;
+            numRecv += numPackets;
             
-            // Update internal state
-            numPacketsReadVector[currentDataChunk][index] = 0;
-            currentDataChunkVector[index] = (currentDataChunk + 1) % 2;
+            commBuffers.numRecvRemaining[index] -= numPackets;
+            if (commBuffers.numRecvRemaining[index] == 0)
+                nodeBuffers.resetNumWritten(index);
         }
+        
+        if (commBuffers.numRecvRemaining[index] > 0)
+            dataOwed = true;
     }
+    
+    return numRecv;
 }
 
 
-
 /*
-    sendAndRecvData()
-    
-    The algorithm is
-    - Irecv data size for all adjacent ranks
-    - ISend data size and then data (if any)
-    - Wait on recv of data size, then blocking recv for data if there is any.
-    
-    Data is sent in two steps to each adjacent rank.
-    First is the number of bytes of data that will be sent.
-    Second is the raw data in bytes.
-    The tag for the first send is 0.
-    The tag for the second send is 1.
+    recvArrivedData
     
-    The raw data is made of data packets containing:
-    globalSide, angle, and data to send.
-    The data can have different meanings depending on the TraverseData 
-    subclass.
+    Receives the data from each adjacent rank whose data size has arrived.
+    If block is true, waits until at least one has arrived.
     
-    When done traversing local graph, you want to stop all communication.
-    This is done by setting killComm to true.
-    To mark killing communication, sendSize is set to UINT64_MAX.
-    In this event, commDark[rank] is set to true on the receiving rank 
-    so we no longer look for communication from this rank.
+    Data from adjacent ranks on this node is read first.  While any of them
+    owe data, MPI cannot be used to wait, so the wait yields the core 
+    instead.
 */
 static
-void sendAndRecvData(const vector<vector<char>> &sendBuffers, 
+void recvArrivedData(CommBuffers &commBuffers, 
                      const vector<UINT> &adjRankIndexToRank, 
                      TraverseData &traverseData, 
                      const UINT dataSizeInBytes, 
-                     set<pair<UINT,UINT>> &sideRecv,
-                     vector<bool> &commDark, const bool killComm)
+                     const vector<vector<UINT>> &commSides,
+                     const UINT nBlockAngles,
+                     NodeBuffers *nodeBuffers,
+                     bool block)
 {
-    // Check input
-    Assert(adjRankIndexToRank.size() == sendBuffers.size());
-    Assert(adjRankIndexToRank.size() == commDark.size());
-    
-    
-    // Variables
-    UINT numAdjRanks = adjRankIndexToRank.size();
+    UINT packetSizeInBytes = packetSize(dataSizeInBytes);
+    vector<UINT> &recvSizes = commBuffers.recvSizes;
+    vector<MPI_Request> &mpiRecvRequests = commBuffers.recvRequests;
     int mpiError;
     
-    vector<UINT> recvSizes(numAdjRanks);
-    vector<UINT> sendSizes(numAdjRanks);
-    vector<MPI_Request> mpiRecvRequests(numAdjRanks);
-    vector<MPI_Request> mpiSendRequests;
-    UINT numRecv = numAdjRanks;
-    
     
-    // Setup recv of data size
-    for (UINT index = 0; index < numAdjRanks; index++) {
-        
-        // No recv if adjRank is no longer communicating
-        if (commDark[index]) {
-            mpiRecvRequests[index] = MPI_REQUEST_NULL;
-            numRecv--;
-            continue;
+    // Recv data from adjacent ranks on this node
+    bool yield = false;
+    if (nodeBuffers != NULL) {
+        bool nodeDataOwed;
+        UINT numNodeRecv = recvNodeData(commBuffers, *nodeBuffers, 
+                                        traverseData, dataSizeInBytes, 
+                                        commSides, nBlockAngles, 
+                                        nodeDataOwed);
+        if (numNodeRecv > 0) {
+            block = false;
         }
-        
-        // Irecv data size
-        int numDataToRecv = 1;
-        int adjRank = adjRankIndexToRank[index];
-        int tag0 = 0;
-        
-        mpiError = MPI_Irecv(&recvSizes[index], numDataToRecv, MPI_UINT64_T, 
-                             adjRank, tag0, MPI_COMM_WORLD, 
-                             &mpiRecvRequests[index]);
+        else if (block && nodeDataOwed) {
+            block = false;
+            yield = true;
+        }
+    }
+    
+    
+    // Find data sizes that have arrived
+    int numCompleted = 0;
+    int *completed = commBuffers.completedIndices.data();
+    if (block) {
+        mpiError = MPI_Waitsome(mpiRecvRequests.size(), mpiRecvRequests.data(),
+                                &numCompleted, completed, MPI_STATUSES_IGNORE);
         Insist(mpiError == MPI_SUCCESS, "");
+        Assert(numCompleted != MPI_UNDEFINED);
     }
+    else {
+        mpiError = MPI_Testsome(mpiRecvRequests.size(), mpiRecvRequests.data(),
+                                &numCompleted, completed, MPI_STATUSES_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+    if (numCompleted == MPI_UNDEFINED)
+        numCompleted = 0;
+    if (yield && numCompleted == 0)
+        this_thread::yield();
     
     
-    // Send data size and data
-    for (UINT index = 0; index < numAdjRanks; index++) {
+    // Recv data
+    for (int i = 0; i < numCompleted; i++) {
         
-        // Don't send if adjRank is no longer communicating
-        if (commDark[index])
-            continue;
-        
-        const vector<char> &sendBuffer = sendBuffers[index];
-        int numDataToSend = 1;
+        UINT index = completed[i];
         int adjRank = adjRankIndexToRank[index];
-        int tag0 = 0;
         int tag1 = 1;
+        recvSizes[index] = commBuffers.recvHeaders[2 * index];
+        if (g_useStarvationHints && 
+            commBuffers.recvHeaders[2 * index + 1] != NO_HINT)
+        {
+            commBuffers.recvHints.push_back(
+                make_pair(index, commBuffers.recvHeaders[2 * index + 1]));
+        }
         
+        // A hint without data (see sendHintOnly)
+        if (recvSizes[index] == 0) {
+            Assert(commBuffers.numRecvRemaining[index] > 0);
+            postSizeRecv(commBuffers, adjRankIndexToRank, index);
+            continue;
+        }
         
-        // Send data size
-        MPI_Request request;
-        sendSizes[index] = sendBuffer.size();
-        if (killComm)
-            sendSizes[index] = UINT64_MAX;
+        vector<char> &dataPackets = commBuffers.recvBuffers[index];
+        dataPackets.resize(recvSizes[index]);
         
-        mpiError = MPI_Isend(&sendSizes[index], numDataToSend, MPI_UINT64_T, 
-                             adjRank, tag0, MPI_COMM_WORLD, &request);
+        mpiError = MPI_Recv(dataPackets.data(), recvSizes[index], 
+                            MPI_BYTE, adjRank, tag1, MPI_COMM_WORLD, 
+                            MPI_STATUS_IGNORE);
         Insist(mpiError == MPI_SUCCESS, "");
-        mpiSendRequests.push_back(request);
         
+        UINT numPackets = recvSizes[index] / packetSizeInBytes;
+        Assert(recvSizes[index] % packetSizeInBytes == 0);
+        Assert(numPackets <= commBuffers.numRecvRemaining[index]);
         
-        // Send data
-        if (sendSizes[index] > 0 && sendSizes[index] != UINT64_MAX) {
-            MPI_Request request;
-            Assert(sendBuffer.size() < INT_MAX);
-            
-            mpiError = MPI_Isend(const_cast<char*>(sendBuffer.data()), 
-                                 sendBuffer.size(), 
-                                 MPI_BYTE, adjRank, tag1, 
-                                 MPI_COMM_WORLD, &request);
-            Insist(mpiError == MPI_SUCCESS, "");
-            mpiSendRequests.push_back(request);
-        }
-    }
-    
-    
-    // Recv data size and data
-    for (UINT numWaits = 0; numWaits < numRecv; numWaits++) {
+        unpackPackets(dataPackets.data(), numPackets, packetSizeInBytes, 
+                      commSides[index], nBlockAngles, traverseData, 
+                      commBuffers.sideRecv);
         
-        // Wait for a data size to arrive
-        int index;
-        mpiError = MPI_Waitany(mpiRecvRequests.size(), mpiRecvRequests.data(), 
-                               &index, MPI_STATUS_IGNORE);
-        Insist(mpiError == MPI_SUCCESS, "");
         
+        // Wait for more data only if this rank still owes some
+        commBuffers.numRecvRemaining[index] -= numPackets;
+        if (commBuffers.numRecvRemaining[index] > 0)
+            postSizeRecv(commBuffers, adjRankIndexToRank, index);
+    }
+}
 
-        // Recv data
-        if (recvSizes[index] > 0 && recvSizes[index] != UINT64_MAX) {
-            
-            int adjRank = adjRankIndexToRank[index];
-            int tag1 = 1;
-            vector<char> dataPackets(recvSizes[index]);
-            
-            mpiError = MPI_Recv(dataPackets.data(), recvSizes[index], 
-                                MPI_BYTE, adjRank, tag1, MPI_COMM_WORLD, 
-                                MPI_STATUS_IGNORE);
-            Insist(mpiError == MPI_SUCCESS, "");
-            
-            UINT packetSize = 2 * sizeof(UINT) + dataSizeInBytes;
-            UINT numPackets = recvSizes[index] / packetSize;
-            Assert(recvSizes[index] % packetSize == 0);
-            
-            for (UINT i = 0; i < numPackets; i++) {
-                char *packet = &dataPackets[i * packetSize];
-                UINT globalSide;
-                UINT angle;
-                char *packetData;
-                splitPacket(packet, globalSide, angle, &packetData);
-                
-                UINT localSide = g_tychoMesh->getGLSide(globalSide);
-                traverseData.setSideData(localSide, angle, packetData);
-                sideRecv.insert(make_pair(localSide,angle));
-            }
+
+/*
+    flushSend
+    
+    Coalescing policy for the data to adjacent rank index (numPackets 
+    packets of sendSize bytes).  Returns true to send it now and false to 
+    hold it so later packets go in the same message.
+    
+    Without CoalesceMessages, or if flushAll is set, data is always sent.
+    Otherwise it is sent when
+    - it is at least g_coalesceBytes, so latency is a small part of its cost
+    - the oldest held packet has waited g_coalesceDeadline
+    - the adjacent rank is starved: it has received nothing from this rank
+      in the traversal, so its sweep may be waiting on these packets
+    - these are the last packets for the adjacent rank
+    flushAll must be set when this rank may wait on adjacent ranks or stop 
+    sending, so held data cannot deadlock the traversal.
+*/
+static
+bool flushSend(CommBuffers &commBuffers, const UINT index, 
+               const UINT sendSize, const UINT numPackets, 
+               const bool flushAll)
+{
+    if (!g_coalesceMessages || flushAll)
+        return true;
+    
+    double now = MPI_Wtime();
+    double &pendingSince = commBuffers.pendingSince[index];
+    if (pendingSince < 0.0)
+        pendingSince = now;
+    
+    return sendSize >= g_coalesceBytes || 
+           now - pendingSince >= g_coalesceDeadline ||
+           commBuffers.numSendRemaining[index] == 
+               commBuffers.numSendPackets[index] ||
+           commBuffers.numSendRemaining[index] == numPackets;
+}
+
+
+/*
+    sendHintOnly
+    
+    Sends a (0, hint) data size message without data to adjacent rank 
+    index (StarvationHints).  A starved rank often has no data for the rank
+    it waits on, or holds it for coalescing, so the hint cannot go with 
+    data.
+    
+    It is only sent while this rank owes the adjacent rank packets, since
+    only then does the adjacent rank have the recv of the data size posted 
+    (see startSendAndRecvData).  A hint is not sent again if it was the 
+    last one sent to that rank.
+*/
+static
+void sendHintOnly(CommBuffers &commBuffers, 
+                  const vector<UINT> &adjRankIndexToRank, const UINT index)
+{
+    UINT hint = commBuffers.sendHints[index];
+    if (hint == NO_HINT || hint == commBuffers.lastSentHints[index] || 
+        commBuffers.numSendRemaining[index] == 0)
+    {
+        return;
+    }
+    Assert(g_useStarvationHints);
+    
+    int adjRank = adjRankIndexToRank[index];
+    int tag0 = 0;
+    commBuffers.sendHeaders[2 * index] = 0;
+    commBuffers.sendHeaders[2 * index + 1] = hint;
+    
+    MPI_Request request;
+    int mpiError = MPI_Isend(&commBuffers.sendHeaders[2 * index], 2, 
+                             MPI_UINT64_T, adjRank, tag0, MPI_COMM_WORLD, 
+                             &request);
+    Insist(mpiError == MPI_SUCCESS, "");
+    commBuffers.sendRequests.push_back(request);
+    
+    commBuffers.lastSentHints[index] = hint;
+    commBuffers.numHintOnlySent++;
+}
+
+
+/*
+    sendAndRecvData()
+    
+    The algorithm is
+    - ISend data size and then data to adjacent ranks with data to send
+    - Recv data for each data size that has arrived.  If block is true, 
+      wait until at least one has arrived.
+    - Wait for the sends to finish, receiving any data that arrives.
+    
+    Data is sent in two steps to each adjacent rank.
+    First is the number of bytes of data that will be sent.
+    Second is the raw data in bytes.
+    The tag for the first send is 0.
+    The tag for the second send is 1.
+    With StarvationHints, the first send also holds commBuffers.sendHints 
+    for the adjacent rank.  If there is no data to send, the hint may be 
+    sent alone (see sendHintOnly).  Hints received in the call are put in 
+    commBuffers.recvHints.
+    
+    The raw data is made of data packets (see appendPacket).
+    The data can have different meanings depending on the TraverseData 
+    subclass.
+    
+    Data to an adjacent rank may be held for a later call (see flushSend).
+    Its send buffers are then not cleared by clearSendBuffers.
+    
+    Termination is by counting packets.  Each rank knows how many packets it 
+    sends to and receives from each adjacent rank in a traversal 
+    (startSendAndRecvData).  The recv of the next data size from an adjacent
+    rank is only posted while that rank owes data.  So a rank never waits on
+    adjacent ranks that are done with it, and when its own traversal is done
+    all its communication is done.
+*/
+static
+void sendAndRecvData(CommBuffers &commBuffers, 
+                     const vector<UINT> &adjRankIndexToRank, 
+                     TraverseData &traverseData, 
+                     const UINT dataSizeInBytes, 
+                     const vector<vector<UINT>> &commSides,
+                     const UINT nBlockAngles,
+                     NodeBuffers *nodeBuffers,
+                     const bool block, const bool flushAll)
+{
+    // Check input
+    Assert(adjRankIndexToRank.size() == commBuffers.recvBuffers.size());
+    
+    
+    // Variables
+    UINT numAdjRanks = adjRankIndexToRank.size();
+    UINT packetSizeInBytes = packetSize(dataSizeInBytes);
+    int mpiError;
+    
+    vector<UINT> &sendSizes = commBuffers.sendSizes;
+    vector<MPI_Request> &mpiSendRequests = commBuffers.sendRequests;
+    mpiSendRequests.clear();
+    commBuffers.recvHints.clear();
+    
+    
+    // Send data size and data
+    for (UINT index = 0; index < numAdjRanks; index++) {
+        
+        commBuffers.holdSend[index] = 0;
+        sendSizes[index] = commBuffers.sendSize(index);
+        bool onNode = (nodeBuffers != NULL && nodeBuffers->onNode(index));
+        if (sendSizes[index] == 0) {
+            if (!onNode)
+                sendHintOnly(commBuffers, adjRankIndexToRank, index);
+            continue;
+        }
+        
+        int numDataToSend = g_useStarvationHints ? 2 : 1;
+        int adjRank = adjRankIndexToRank[index];
+        int tag0 = 0;
+        int tag1 = 1;
+        UINT numPackets = sendSizes[index] / packetSizeInBytes;
+        Assert(numPackets <= commBuffers.numSendRemaining[index]);
+        
+        if (!onNode && !flushSend(commBuffers, index, sendSizes[index], 
+                                  numPackets, flushAll))
+        {
+            commBuffers.holdSend[index] = 1;
+            sendHintOnly(commBuffers, adjRankIndexToRank, index);
+            continue;
         }
+        commBuffers.pendingSince[index] = -1.0;
+        commBuffers.numSendRemaining[index] -= numPackets;
         
         
-        // Stop communication with this rank
-        if (recvSizes[index] == UINT64_MAX) {
-            commDark[index] = true;
+        // Adjacent rank on this node
+        // Write the packets after the ones already written and set the 
+        // count.  There is room for all packets of the traversal.
+        if (onNode) {
+            UINT &position = commBuffers.nodeSendPositions[index];
+            char *buffer = 
+                nodeBuffers->sendBuffer(index) + position * packetSizeInBytes;
+            for (const auto &angleGroupBuffers : commBuffers.sendBuffers) {
+                const vector<char> &sendBuffer = angleGroupBuffers[index];
+                memcpy(buffer, sendBuffer.data(), sendBuffer.size());
+                buffer += sendBuffer.size();
+            }
+            position += numPackets;
+            nodeBuffers->putNumWritten(index, position);
+            continue;
         }
+        
+        
+        // Send data size (and hint)
+        MPI_Request request;
+        commBuffers.sendHeaders[2 * index] = sendSizes[index];
+        commBuffers.sendHeaders[2 * index + 1] = commBuffers.sendHints[index];
+        if (commBuffers.sendHints[index] != NO_HINT)
+            commBuffers.lastSentHints[index] = commBuffers.sendHints[index];
+        mpiError = MPI_Isend(&commBuffers.sendHeaders[2 * index], 
+                             numDataToSend, MPI_UINT64_T, adjRank, tag0, 
+                             MPI_COMM_WORLD, &request);
+        Insist(mpiError == MPI_SUCCESS, "");
+        mpiSendRequests.push_back(request);
+        
+        
+        // Send data
+        // The angle group buffers are sent in place as one message using
+        // an hindexed datatype over their addresses.
+        MPI_Datatype sendType = createSendType(commBuffers, index);
+        mpiError = MPI_Isend(MPI_BOTTOM, 1, sendType, adjRank, tag1, 
+                             MPI_COMM_WORLD, &request);
+        Insist(mpiError == MPI_SUCCESS, "");
+        mpiSendRequests.push_back(request);
+        
+        mpiError = MPI_Type_free(&sendType);
+        Insist(mpiError == MPI_SUCCESS, "");
     }
     
     
+    // Recv data that has arrived
+    recvArrivedData(commBuffers, adjRankIndexToRank, traverseData, 
+                    dataSizeInBytes, commSides, nBlockAngles, nodeBuffers, 
+                    block);
+    
+    
     // Make sure all sends are done
-    if (mpiSendRequests.size() > 0) {
-        mpiError = MPI_Waitall(mpiSendRequests.size(), mpiSendRequests.data(), 
-                               MPI_STATUSES_IGNORE);
+    // Keep receiving meanwhile, since adjacent ranks may be waiting on 
+    // their own sends to this rank.
+    while (mpiSendRequests.size() > 0) {
+        int sendsDone;
+        mpiError = MPI_Testall(mpiSendRequests.size(), mpiSendRequests.data(), 
+                               &sendsDone, MPI_STATUSES_IGNORE);
         Insist(mpiError == MPI_SUCCESS, "");
+        if (sendsDone)
+            break;
+        
+        const bool noBlock = false;
+        recvArrivedData(commBuffers, adjRankIndexToRank, traverseData, 
+                        dataSizeInBytes, commSides, nBlockAngles, 
+                        nodeBuffers, noBlock);
     }
+}
+
 
+/*
+    neighborSendAndRecvData
+    
+    Exchanges data with all adjacent ranks using neighborhood collectives.
+    The data sizes are exchanged with MPI_Neighbor_alltoall and the data
+    with MPI_Neighbor_alltoallw, which sends the angle group buffers in 
+    place.
+    
+    With nodeAggregator, the data is exchanged through it instead.
+    
+    Every rank must make the same number of calls, so ranks keep calling
+    after their own traversal is done.  localDone means this call sends the
+    last data of the rank.  It is reduced over all ranks with an 
+    MPI_Iallreduce that is completed in the next call, so allDone is set 
+    in the call after the one in which all ranks sent their last data, on 
+    every rank at once.
+*/
+static
+void neighborSendAndRecvData(CommBuffers &commBuffers, 
+                             const MPI_Comm &neighborComm,
+                             TraverseData &traverseData, 
+                             const UINT dataSizeInBytes, 
+                             const vector<vector<UINT>> &commSides,
+                             const UINT nBlockAngles,
+                             NodeAggregator *nodeAggregator,
+                             const bool localDone, bool &allDone)
+{
+    UINT numAdjRanks = commBuffers.recvBuffers.size();
+    int mpiError;
+    
+    
+    // Exchange data through node leaders or with neighborhood collectives
+    if (nodeAggregator != NULL) {
+        nodeAggregator->exchange(commBuffers.sendBuffers, 
+                                 commBuffers.recvBuffers);
+        for (UINT index = 0; index < numAdjRanks; index++) {
+            commBuffers.recvSizes[index] = 
+                commBuffers.recvBuffers[index].size();
+        }
+    }
+    else {
+        
+        // Exchange data sizes
+        for (UINT index = 0; index < numAdjRanks; index++) {
+            commBuffers.sendSizes[index] = commBuffers.sendSize(index);
+        }
+        mpiError = MPI_Neighbor_alltoall(
+            commBuffers.sendSizes.data(), 1, MPI_UINT64_T, 
+            commBuffers.recvSizes.data(), 1, MPI_UINT64_T, neighborComm);
+        Insist(mpiError == MPI_SUCCESS, "");
+        
+        
+        // Exchange data
+        // Buffers are given by absolute address relative to MPI_BOTTOM
+        for (UINT index = 0; index < numAdjRanks; index++) {
+            
+            UINT recvSize = commBuffers.recvSizes[index];
+            Assert(recvSize < INT_MAX);
+            commBuffers.recvBuffers[index].resize(recvSize);
+            commBuffers.recvCounts[index] = recvSize;
+            commBuffers.recvTypes[index] = MPI_BYTE;
+            commBuffers.recvDispls[index] = 0;
+            if (recvSize > 0) {
+                mpiError = MPI_Get_address(
+                    commBuffers.recvBuffers[index].data(), 
+                    &commBuffers.recvDispls[index]);
+                Insist(mpiError == MPI_SUCCESS, "");
+            }
+            
+            commBuffers.sendDispls[index] = 0;
+            if (commBuffers.sendSizes[index] > 0) {
+                commBuffers.sendCounts[index] = 1;
+                commBuffers.sendTypes[index] = 
+                    createSendType(commBuffers, index);
+            }
+            else {
+                commBuffers.sendCounts[index] = 0;
+                commBuffers.sendTypes[index] = MPI_BYTE;
+            }
+        }
+        
+        mpiError = MPI_Neighbor_alltoallw(
+            MPI_BOTTOM, commBuffers.sendCounts.data(), 
+            commBuffers.sendDispls.data(), commBuffers.sendTypes.data(), 
+            MPI_BOTTOM, commBuffers.recvCounts.data(), 
+            commBuffers.recvDispls.data(), commBuffers.recvTypes.data(), 
+            neighborComm);
+        Insist(mpiError == MPI_SUCCESS, "");
+        
+        for (UINT index = 0; index < numAdjRanks; index++) {
+            if (commBuffers.sendSizes[index] > 0) {
+                mpiError = MPI_Type_free(&commBuffers.sendTypes[index]);
+                Insist(mpiError == MPI_SUCCESS, "");
+            }
+        }
+    }
+    
+    
+    // Unpack data
+    UINT packetSizeInBytes = packetSize(dataSizeInBytes);
+    for (UINT index = 0; index < numAdjRanks; index++) {
+        UINT numPackets = commBuffers.recvSizes[index] / packetSizeInBytes;
+        Assert(commBuffers.recvSizes[index] % packetSizeInBytes == 0);
+        unpackPackets(commBuffers.recvBuffers[index].data(), numPackets, 
+                      packetSizeInBytes, commSides[index], nBlockAngles, 
+                      traverseData, commBuffers.sideRecv);
+    }
+    
+    
+    // Termination
+    // Finish the reduction from the last call, then start this call's
+    allDone = false;
+    if (commBuffers.doneRequest != MPI_REQUEST_NULL) {
+        mpiError = MPI_Wait(&commBuffers.doneRequest, MPI_STATUS_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
+        allDone = (commBuffers.allDone != 0);
+    }
+    
+    if (!allDone) {
+        commBuffers.localDone = localDone ? 1 : 0;
+        mpiError = MPI_Iallreduce(&commBuffers.localDone, 
+                                  &commBuffers.allDone, 1, MPI_INT, MPI_LAND, 
+                                  neighborComm, &commBuffers.doneRequest);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
 }
 
 
@@ -601,11 +1137,15 @@ void sendAndRecvData(const vector<vector<char>> &sendBuffers,
     If doComm is true, graph traversal is global.
     If doComm is false, each mesh partition is traversed locally with no
     consideration for boundaries between partitions.
+    
+    If nGroupBlocks > 1, the graph is traversed once for each group block
+    and the blocks are pipelined.  The angle passed to TraverseData is then
+    groupBlock * g_nAngles + angle.
 */
 GraphTraverser::GraphTraverser(Direction direction, bool doComm, 
-                               UINT dataSizeInBytes)
+                               UINT dataSizeInBytes, UINT nGroupBlocks)
     : c_direction(direction), c_doComm(doComm), 
-      c_dataSizeInBytes(dataSizeInBytes)
+      c_dataSizeInBytes(dataSizeInBytes), c_nGroupBlocks(nGroupBlocks)
 {
     // Get adjacent ranks
     for (UINT cell = 0; cell < g_nCells; cell++) {
@@ -622,124 +1162,1267 @@ GraphTraverser::GraphTraverser(Direction direction, bool doComm,
             c_adjRankToRankIndex.insert(make_pair(adjRank, rankIndex));
             c_adjRankIndexToRank.push_back(adjRank);
         }
-    }}
-    
-    
-    // Calc num dependencies for each (cell, angle) pair
-    c_initNumDependencies.resize(g_nAngles, g_nCells);
-    for (UINT cell = 0; cell < g_nCells; cell++) {
-    for (UINT angle = 0; angle < g_nAngles; angle++) {
+    }}
+    setupCommSides();
+    
+    
+    // Communicator for neighborhood collectives
+    // Node aggregation also takes a step on all ranks at once, so it uses
+    // the same termination.
+    c_useNeighborComm = 
+        c_doComm && (g_useNeighborCollectives || g_useNodeAggregation) && 
+        !g_useOneSidedMPI;
+    if (c_useNeighborComm) {
+        c_neighborComm = Comm::createNeighborComm(c_adjRankIndexToRank);
+    }
+    
+    c_nodeAggregator = NULL;
+    if (c_useNeighborComm && g_useNodeAggregation) {
+        c_nodeAggregator = new NodeAggregator(c_adjRankIndexToRank, 
+                                              g_nodeAggregationRanksPerNode);
+    }
+    
+    
+    // Node shared memory for two-sided communication
+    // Each buffer holds all packets from the adjacent rank in a traversal.
+    c_nodeBuffers = NULL;
+    if (c_doComm && g_useSharedMemoryComm && !g_useOneSidedMPI && 
+        !c_useNeighborComm) 
+    {
+        UINT packetSizeInBytes = packetSize(c_dataSizeInBytes);
+        vector<UINT> recvSizes(c_adjRankIndexToRank.size());
+        for (UINT i = 0; i < recvSizes.size(); i++) {
+            recvSizes[i] = c_numRecvPackets[i] * packetSizeInBytes;
+        }
+        c_nodeBuffers = new NodeBuffers(c_adjRankIndexToRank, recvSizes);
+    }
+    
+    
+    // Calc num dependencies for each (cell, angle) pair
+    c_initNumDependencies.resize(g_nAngles, g_nCells);
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT angle = 0; angle < g_nAngles; angle++) {
+        
+        c_initNumDependencies(angle, cell) = 0;
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            
+            bool incoming = isIncoming(angle, cell, face, c_direction);
+            UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+            UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+            
+            if (c_doComm && incoming && adjRank != TychoMesh::BAD_RANK) {
+                c_initNumDependencies(angle, cell)++;
+            }
+            else if (!c_doComm && incoming && adjCell != TychoMesh::BOUNDARY_FACE) {
+                c_initNumDependencies(angle, cell)++;
+            }
+        }
+    }}
+
+
+    // Setup one-sided MPI
+    if (g_useOneSidedMPI) {
+        setupOneSidedMPI();
+    }
+    
+    
+    // Cluster cells into patches
+    c_patchSize = g_patchSize;
+    if (c_patchSize > 1) {
+        setupPatches();
+    }
+}
+
+
+/*
+    setupCommSides
+    
+    Orders the sides shared with each adjacent rank by global side.
+    The adjacent rank computes the same ordering, so packets refer to a side
+    by its index in the ordering instead of its global side.
+    
+    Also counts the packets sent to and received from each adjacent rank 
+    in a traversal.
+*/
+void GraphTraverser::setupCommSides()
+{
+    UINT numAdjRanks = c_adjRankIndexToRank.size();
+    vector<vector<pair<UINT,UINT>>> globalLocalSides(numAdjRanks);
+    
+    c_sideRankIndex.assign(g_tychoMesh->getNSides(), UINT64_MAX);
+    c_sideCommIndex.assign(g_tychoMesh->getNSides(), UINT64_MAX);
+    c_numSendPackets.assign(numAdjRanks, 0);
+    c_numRecvPackets.assign(numAdjRanks, 0);
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
+        
+        UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+        UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+        
+        if (adjCell == TychoMesh::BOUNDARY_FACE && 
+            adjRank != TychoMesh::BAD_RANK)
+        {
+            UINT side = g_tychoMesh->getSide(cell, face);
+            UINT rankIndex = c_adjRankToRankIndex.at(adjRank);
+            c_sideRankIndex[side] = rankIndex;
+            globalLocalSides[rankIndex].push_back(
+                make_pair(g_tychoMesh->getLGSide(side), side));
+            
+            for (UINT angle = 0; angle < g_nAngles; angle++) {
+                if (isIncoming(angle, cell, face, c_direction))
+                    c_numRecvPackets[rankIndex] += c_nGroupBlocks;
+                else
+                    c_numSendPackets[rankIndex] += c_nGroupBlocks;
+            }
+        }
+    }}
+    
+    c_commSides.resize(numAdjRanks);
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        sort(globalLocalSides[rankIndex].begin(), 
+             globalLocalSides[rankIndex].end());
+        for (auto globalLocalSide : globalLocalSides[rankIndex]) {
+            UINT side = globalLocalSide.second;
+            c_sideCommIndex[side] = c_commSides[rankIndex].size();
+            c_commSides[rankIndex].push_back(side);
+        }
+    }
+}
+
+
+/*
+    setupPatches
+    
+    Clusters cells into patches for each angle.
+    A patch is traversed as one task in a precomputed order.
+    
+    Seeds are taken in topological order, breaking ties by a space-filling
+    curve key.  A patch grows from its seed (in space-filling curve order)
+    with children of the patch whose parents have all been assigned, until 
+    it reaches c_patchSize cells.  So each patch is a contiguous chunk of a
+    topological order and the graph of patches on a rank is acyclic.
+    
+    With communication, this is not enough.  Patches on different ranks 
+    could form a cycle.  So in this case each patch has a single entry 
+    point, its seed cell.  All dependencies from outside the patch (other
+    patches or other ranks) are on the seed, and every other cell in the 
+    patch has all its parents in the patch.  Then a cycle of patches 
+    would imply a cycle of cells through the seeds.
+    
+    Dependencies are counted per patch.  The seed holds the number of 
+    dependencies from outside the patch.  The other cells hold the number 
+    of parents in the patch, which is never decremented, so they are never
+    put on the queue themselves.
+*/
+void GraphTraverser::setupPatches()
+{
+    typedef pair<UINT,UINT> KeyCell;
+    typedef priority_queue<KeyCell, vector<KeyCell>, greater<KeyCell>> 
+        KeyCellQueue;
+    const UINT NO_PATCH = UINT64_MAX;
+    
+    vector<UINT> sfcKeys;
+    calcSfcKeys(sfcKeys);
+    
+    c_patchCells.resize(g_nCells, g_nAngles);
+    c_patchBegin.resize(g_nCells, g_nAngles);
+    c_patchEnd.resize(g_nCells, g_nAngles);
+    UINT numPatches = 0;
+    
+    
+    for (UINT angle = 0; angle < g_nAngles; angle++) {
+        
+        // Number of local parents and if cell must be a seed
+        vector<UINT> numLocalParents(g_nCells, 0);
+        vector<bool> isSeedOnly(g_nCells, false);
+        vector<UINT> parentPatch(g_nCells, NO_PATCH);
+        vector<bool> hasMixedParents(g_nCells, false);
+        for (UINT cell = 0; cell < g_nCells; cell++) {
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            
+            if (!isIncoming(angle, cell, face, c_direction))
+                continue;
+            
+            UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+            UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+            if (adjCell != TychoMesh::BOUNDARY_FACE)
+                numLocalParents[cell]++;
+            else if (c_doComm && adjRank != TychoMesh::BAD_RANK)
+                isSeedOnly[cell] = true;
+        }}
+        
+        
+        // Cells ready to be seeds
+        KeyCellQueue seedQueue;
+        for (UINT cell = 0; cell < g_nCells; cell++) {
+            if (numLocalParents[cell] == 0)
+                seedQueue.push(make_pair(sfcKeys[cell], cell));
+        }
+        
+        
+        // Create patches
+        UINT index = 0;
+        while (seedQueue.size() > 0) {
+            
+            UINT seed = seedQueue.top().second;
+            seedQueue.pop();
+            
+            UINT patchBegin = index;
+            KeyCellQueue growQueue;
+            growQueue.push(make_pair(sfcKeys[seed], seed));
+            
+            while (growQueue.size() > 0) {
+                
+                // Add cell to patch
+                UINT cell = growQueue.top().second;
+                growQueue.pop();
+                c_patchCells(index, angle) = cell;
+                c_patchBegin(cell, angle) = patchBegin;
+                index++;
+                
+                
+                // Children of the cell
+                for (UINT face = 0; face < g_nFacePerCell; face++) {
+                    
+                    UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+                    if (isIncoming(angle, cell, face, c_direction) ||
+                        adjCell == TychoMesh::BOUNDARY_FACE)
+                    {
+                        continue;
+                    }
+                    
+                    if (parentPatch[adjCell] == NO_PATCH)
+                        parentPatch[adjCell] = patchBegin;
+                    else if (parentPatch[adjCell] != patchBegin)
+                        hasMixedParents[adjCell] = true;
+                    
+                    numLocalParents[adjCell]--;
+                    if (numLocalParents[adjCell] == 0) {
+                        
+                        KeyCell keyCell = make_pair(sfcKeys[adjCell], adjCell);
+                        bool isSingleEntry = 
+                            parentPatch[adjCell] == patchBegin &&
+                            !hasMixedParents[adjCell] && 
+                            !isSeedOnly[adjCell];
+                        if (!c_doComm || isSingleEntry) {
+                            growQueue.push(keyCell);
+                        }
+                        else {
+                            seedQueue.push(keyCell);
+                        }
+                    }
+                }
+                
+                
+                // Patch is full.  Remaining candidates become seeds.
+                if (index - patchBegin == c_patchSize) {
+                    while (growQueue.size() > 0) {
+                        seedQueue.push(growQueue.top());
+                        growQueue.pop();
+                    }
+                }
+            }
+            
+            
+            // Set end of patch
+            for (UINT i = patchBegin; i < index; i++) {
+                c_patchEnd(c_patchCells(i, angle), angle) = index;
+            }
+            numPatches++;
+        }
+        
+        Insist(index == g_nCells, "Cycle in graph found creating patches.");
+        
+        
+        // Dependencies per patch
+        vector<UINT> numDependencies(g_nCells, 0);
+        for (UINT cell = 0; cell < g_nCells; cell++) {
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            
+            UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+            UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+            if (!isIncoming(angle, cell, face, c_direction))
+                continue;
+            
+            if (adjCell != TychoMesh::BOUNDARY_FACE &&
+                c_patchBegin(adjCell, angle) == c_patchBegin(cell, angle))
+            {
+                numDependencies[cell]++;
+            }
+            else if (adjCell != TychoMesh::BOUNDARY_FACE ||
+                     (c_doComm && adjRank != TychoMesh::BAD_RANK))
+            {
+                numDependencies[getPatchSeed(cell, angle)]++;
+            }
+        }}
+        
+        for (UINT cell = 0; cell < g_nCells; cell++) {
+            c_initNumDependencies(angle, cell) = numDependencies[cell];
+        }
+    }
+    
+    
+    // Print patch stats
+    UINT numCellAnglePairs = g_nCells * g_nAngles;
+    Comm::gsum(numPatches);
+    Comm::gsum(numCellAnglePairs);
+    if (Comm::rank() == 0) {
+        printf("Patch size: %" PRIu64 "   Avg cells per patch: %f\n",
+               c_patchSize, (double) numCellAnglePairs / numPatches);
+    }
+}
+
+
+/*
+    getPatchSeed
+    
+    Returns the seed (first cell) of the patch containing the cell.
+*/
+UINT GraphTraverser::getPatchSeed(UINT cell, UINT angle)
+{
+    if (c_patchSize == 1)
+        return cell;
+    
+    return c_patchCells(c_patchBegin(cell, angle), angle);
+}
+
+
+/*
+    getPatchPriority
+    
+    Returns the max priority of the cells in the patch with the given seed.
+    blockAngle = groupBlock * g_nAngles + angle.
+*/
+template <typename TraverseDataType>
+UINT GraphTraverser::getPatchPriority(UINT cell, UINT blockAngle, 
+                                      TraverseDataType &traverseData)
+{
+    if (c_patchSize == 1)
+        return traverseData.getPriority(cell, blockAngle);
+    
+    UINT angle = blockAngle % g_nAngles;
+    UINT priority = 0;
+    for (UINT i = c_patchBegin(cell, angle); i < c_patchEnd(cell, angle); i++) {
+        UINT patchCell = c_patchCells(i, angle);
+        priority = max(priority, 
+                       traverseData.getPriority(patchCell, blockAngle));
+    }
+    return priority;
+}
+
+
+/*
+    setupStarvationHints
+    
+    Orders the packets this rank receives from each adjacent rank by the 
+    priority of the cell receiving them, most urgent first.  The first one 
+    not received yet is the hint sent to that rank (see setSendHints).
+*/
+template <typename TraverseDataType>
+void GraphTraverser::setupStarvationHints(StarvationHints &hints, 
+                                          TraverseDataType &traverseData)
+{
+    UINT nBlockAngles = c_nGroupBlocks * g_nAngles;
+    UINT numAdjRanks = c_adjRankIndexToRank.size();
+    vector<vector<pair<UINT,UINT>>> priorityIndices(numAdjRanks);
+    
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
+        
+        UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+        UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+        
+        if (adjCell == TychoMesh::BOUNDARY_FACE && 
+            adjRank != TychoMesh::BAD_RANK)
+        {
+            UINT side = g_tychoMesh->getSide(cell, face);
+            UINT rankIndex = c_sideRankIndex[side];
+            
+            for (UINT blockAngle = 0; blockAngle < nBlockAngles; 
+                 blockAngle++) 
+            {
+                UINT angle = blockAngle % g_nAngles;
+                if (isIncoming(angle, cell, face, c_direction)) {
+                    UINT seed = getPatchSeed(cell, angle);
+                    UINT priority = 
+                        getPatchPriority(seed, blockAngle, traverseData);
+                    UINT index = 
+                        c_sideCommIndex[side] * nBlockAngles + blockAngle;
+                    priorityIndices[rankIndex].push_back(
+                        make_pair(priority, index));
+                }
+            }
+        }
+    }}
+    
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        sort(priorityIndices[rankIndex].begin(), 
+             priorityIndices[rankIndex].end(), 
+             [](const pair<UINT,UINT> &a, const pair<UINT,UINT> &b) {
+                 return a.first > b.first || 
+                        (a.first == b.first && a.second < b.second);
+             });
+        for (auto priorityIndex : priorityIndices[rankIndex])
+            hints.recvOrder[rankIndex].push_back(priorityIndex.second);
+        hints.isRecv[rankIndex].assign(
+            c_commSides[rankIndex].size() * nBlockAngles, 0);
+    }
+}
+
+
+/*
+    setSendHints
+    
+    Sets the hint for each adjacent rank.  If this rank is starved, it is 
+    the most urgent packet not yet received from that rank, otherwise 
+    NO_HINT.
+*/
+static
+void setSendHints(StarvationHints &hints, const bool starved, 
+                  vector<UINT> &sendHints)
+{
+    for (UINT rankIndex = 0; rankIndex < sendHints.size(); rankIndex++) {
+        
+        sendHints[rankIndex] = NO_HINT;
+        if (!starved)
+            continue;
+        
+        const vector<UINT> &recvOrder = hints.recvOrder[rankIndex];
+        UINT &cursor = hints.recvCursor[rankIndex];
+        while (cursor < recvOrder.size() && 
+               hints.isRecv[rankIndex][recvOrder[cursor]])
+        {
+            cursor++;
+        }
+        if (cursor < recvOrder.size())
+            sendHints[rankIndex] = recvOrder[cursor];
+    }
+}
+
+
+/*
+    boostUpstream
+    
+    Boosts the seed of the patch containing the (cell, blockAngle) pair and
+    the seeds upstream of it that are not done, up to maxSeeds of them.
+    Boosted seeds that are ready are put on the urgent queue.  The search is
+    depth first, so it follows a chain of parents to the ready work feeding
+    the cell.
+    
+    Only the seed of a patch has parents outside the patch 
+    (see setupPatches), so following the parents of seeds finds all the 
+    upstream patches.
+*/
+template <typename TraverseDataType>
+void GraphTraverser::boostUpstream(StarvationHints &hints, UINT cell, 
+                                   UINT blockAngle, 
+                                   const Mat2<UINT> &numDependencies, 
+                                   UINT maxSeeds,
+                                   TraverseDataType &traverseData)
+{
+    UINT angle = blockAngle % g_nAngles;
+    UINT angleGroup = angleGroupIndex(angle);
+    vector<UINT> seeds(1, getPatchSeed(cell, angle));
+    UINT numBoosted = 0;
+    
+    while (seeds.size() > 0 && numBoosted < maxSeeds) {
+        
+        UINT seed = seeds.back();
+        seeds.pop_back();
+        if (hints.isDone(blockAngle, seed) || hints.isBoosted(blockAngle, seed))
+            continue;
+        hints.isBoosted(blockAngle, seed) = 1;
+        numBoosted++;
+        
+        if (numDependencies(blockAngle, seed) == 0) {
+            UINT priority = getPatchPriority(seed, blockAngle, traverseData);
+            hints.urgent[angleGroup].push(Tuple(seed, blockAngle, priority));
+            continue;
+        }
+        
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            UINT adjCell = g_tychoMesh->getAdjCell(seed, face);
+            if (adjCell != TychoMesh::BOUNDARY_FACE && 
+                isIncoming(angle, seed, face, c_direction))
+            {
+                seeds.push_back(getPatchSeed(adjCell, angle));
+            }
+        }
+    }
+    
+    hints.numBoosted += numBoosted;
+}
+
+
+/*
+    adaptStepSize
+    
+    Chooses the number of cell/angle pairs to compute before the next
+    communication step from the last step's compute time, comm time and the
+    number of cell/angle pairs ready to compute (queue depth).
+    
+    If there is not a full step of work ready, the pipeline is not full and
+    neighbors are likely waiting on our boundary data, so the step is 
+    halved to send data sooner.  If the queues hold several steps of work and
+    communication costs more than computation, the step is doubled to 
+    amortize the cost of each message.
+    The step stays in [maxComputePerStep / ADAPTIVE_STEP_FACTOR, 
+    maxComputePerStep * ADAPTIVE_STEP_FACTOR].
+*/
+static
+UINT adaptStepSize(const UINT stepSize, const UINT maxComputePerStep,
+                   const double computeTime, const double commTime, 
+                   const UINT queueDepth)
+{
+    UINT minStep = max(maxComputePerStep / ADAPTIVE_STEP_FACTOR, (UINT)1);
+    UINT maxStep = maxComputePerStep * ADAPTIVE_STEP_FACTOR;
+    
+    if (queueDepth < stepSize)
+        return max(stepSize / 2, minStep);
+    
+    if (queueDepth >= 2 * stepSize && commTime > computeTime)
+        return min(2 * stepSize, maxStep);
+    
+    return stepSize;
+}
+
+
+/*
+    setupOneSidedMPI
+*/
+void GraphTraverser::setupOneSidedMPI()
+{
+    int mpiError;
+    c_ringSize = g_oneSidedRingSize;
+    if (c_ringSize == 0) {
+        c_ringSize = 20 * g_maxCellsPerStep;
+        if (g_adaptiveCellsPerStep)
+            c_ringSize *= ADAPTIVE_STEP_FACTOR;
+    }
+    
+    
+    // Allocate MPI_Win
+    UINT numAdjRanks = c_adjRankIndexToRank.size();
+    UINT packetSizeInBytes = packetSize(c_dataSizeInBytes);
+    UINT slotSizeInBytes = RING_DATA_OFFSET + c_ringSize * packetSizeInBytes;
+    UINT windowSizeInBytes = slotSizeInBytes * numAdjRanks;
+    MPI_Info mpiInfo;
+    MPI_Info_create(&mpiInfo);
+    MPI_Info_set(mpiInfo, "accumulate_ops", "same_op_no_op");
+    MPI_Win_allocate(windowSizeInBytes, 1, mpiInfo, 
+                     MPI_COMM_WORLD, &c_mpiWinMemory, &c_mpiWin);
+    MPI_Info_free(&mpiInfo);
+
+
+    // Setup onRankOffsets
+    c_onRankOffsets.resize(numAdjRanks);
+    for (UINT i = 0; i < numAdjRanks; i++) {
+        c_onRankOffsets[i] = i * slotSizeInBytes;
+    }
+    c_numPacketsSent.assign(numAdjRanks, 0);
+    c_numPacketsRecv.assign(numAdjRanks, 0);
+    c_sendBacklog.resize(numAdjRanks);
+
+
+    // Setup offRankOffsets
+    c_offRankOffsets.resize(numAdjRanks);
+    vector<MPI_Request> mpiSendRequests(numAdjRanks);
+    vector<MPI_Request> mpiRecvRequests(numAdjRanks);
+    for (UINT i = 0; i < numAdjRanks; i++) {
+        UINT adjRank = c_adjRankIndexToRank[i];
+        int tag = 0;
+        
+        // Send index
+        mpiError = MPI_Isend(&c_onRankOffsets[i], 1, MPI_UINT64_T, adjRank, 
+                             tag, MPI_COMM_WORLD, &mpiSendRequests[i]);
+        Insist(mpiError == MPI_SUCCESS, "");
+
+        // Recv index
+        mpiError = MPI_Irecv(&c_offRankOffsets[i], 1, MPI_UINT64_T, adjRank, 
+                             tag, MPI_COMM_WORLD, &mpiRecvRequests[i]);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+    
+
+    // Wait for messages to send/recv
+    if (numAdjRanks > 0) {
+        mpiError = MPI_Waitall(mpiSendRequests.size(), mpiSendRequests.data(), 
+                               MPI_STATUSES_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
+        
+        mpiError = MPI_Waitall(mpiRecvRequests.size(), mpiRecvRequests.data(), 
+                               MPI_STATUSES_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+
+
+    // Lock the window to start RMA operations and set memory to zero
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, c_mpiWin);
+    memset(c_mpiWinMemory, 0, windowSizeInBytes);
+    MPI_Win_sync(c_mpiWin);
+    Comm::barrier();
+    
+
+    // Print out use of one-sided MPI
+    if (Comm::rank() == 0) {
+        if (g_useOneSidedMPI)
+            printf("Using one-sided MPI.\n");
+        else
+            printf("NOT using one-sided MPI.\n");
+    }
+}
+
+
+/*
+    putPackets
+    
+    Puts packets into the ring buffer of an adjacent rank, wrapping around
+    the end of the ring.  The caller checks there is room.
+*/
+void GraphTraverser::putPackets(const char *packets, UINT numPackets, 
+                                const UINT rankIndex)
+{
+    int mpiError;
+    int adjRank = c_adjRankIndexToRank[rankIndex];
+    UINT packetSizeInBytes = packetSize(c_dataSizeInBytes);
+    
+    while (numPackets > 0) {
+        UINT position = c_numPacketsSent[rankIndex] % c_ringSize;
+        UINT num = min(numPackets, c_ringSize - position);
+        UINT sizeInBytes = num * packetSizeInBytes;
+        UINT offset = c_offRankOffsets[rankIndex] + RING_DATA_OFFSET + 
+                      position * packetSizeInBytes;
+        
+        mpiError = MPI_Put(packets, sizeInBytes, MPI_BYTE, adjRank, offset, 
+                           sizeInBytes, MPI_BYTE, c_mpiWin);
+        Insist(mpiError == MPI_SUCCESS, "");
+        
+        packets += sizeInBytes;
+        numPackets -= num;
+        c_numPacketsSent[rankIndex] += num;
+    }
+}
+
+
+/*
+    sendOneSided
+
+    Sends this step's packets to each adjacent rank through its ring buffer.
+    If the ring does not have room, the packets are appended to the backlog 
+    for that rank and as many backlog packets as fit are sent.
+*/
+void GraphTraverser::sendOneSided(
+    const vector<vector<vector<char>>> &sendBuffers)
+{
+    int mpiError;
+    UINT numAdjRanks = c_adjRankIndexToRank.size();
+    UINT packetSizeInBytes = packetSize(c_dataSizeInBytes);
+    
+    for (UINT index = 0; index < numAdjRanks; index++) {
+        
+        // Packets to send this step
+        UINT sendSize = 0;
+        for (const auto &angleGroupBuffers : sendBuffers)
+            sendSize += angleGroupBuffers[index].size();
+        
+        vector<char> &backlog = c_sendBacklog[index];
+        if (sendSize == 0 && backlog.size() == 0)
+            continue;
+        
+        
+        // Room left in the adjacent rank's ring
+        UINT numPacketsRead = 
+            fetchCount(c_onRankOffsets[index] + RING_READ_OFFSET, c_mpiWin);
+        UINT numFree = c_ringSize - (c_numPacketsSent[index] - numPacketsRead);
+        
+        
+        // Put directly from the send buffers if everything fits
+        UINT numPacketsPut = 0;
+        bool fromBacklog = backlog.size() > 0 || 
+                           sendSize / packetSizeInBytes > numFree;
+        if (!fromBacklog) {
+            for (const auto &angleGroupBuffers : sendBuffers) {
+                const vector<char> &sendBuffer = angleGroupBuffers[index];
+                UINT numPackets = sendBuffer.size() / packetSizeInBytes;
+                putPackets(sendBuffer.data(), numPackets, index);
+                numPacketsPut += numPackets;
+            }
+        }
+        
+        // Otherwise queue behind the backlog and send what fits
+        else {
+            for (const auto &angleGroupBuffers : sendBuffers) {
+                const vector<char> &sendBuffer = angleGroupBuffers[index];
+                backlog.insert(backlog.end(), 
+                               sendBuffer.begin(), sendBuffer.end());
+            }
+            numPacketsPut = min(backlog.size() / packetSizeInBytes, numFree);
+            putPackets(backlog.data(), numPacketsPut, index);
+        }
+        
+        if (numPacketsPut == 0)
+            continue;
+        
+        
+        // Data must arrive before the written count is updated
+        int adjRank = c_adjRankIndexToRank[index];
+        mpiError = MPI_Win_flush(adjRank, c_mpiWin);
+        Insist(mpiError == MPI_SUCCESS, "");
+        
+        if (fromBacklog) {
+            backlog.erase(backlog.begin(), 
+                          backlog.begin() + numPacketsPut * packetSizeInBytes);
+        }
+        
+        putCount(c_numPacketsSent[index], adjRank, 
+                 c_offRankOffsets[index] + RING_WRITTEN_OFFSET, c_mpiWin);
+    }
+}
+
+
+/*
+    recvOneSided
+
+    Reads the packets written to this rank's ring buffers since the last 
+    call, then gives the space back to the senders.
+*/
+void GraphTraverser::recvOneSided(TraverseData &traverseData,
+                                  vector<vector<char>> &recvBuffers,
+                                  vector<pair<UINT,UINT>> &sideRecv)
+{
+    int mpiError;
+    int myRank = Comm::rank();
+    UINT numAdjRanks = c_adjRankIndexToRank.size();
+    UINT packetSizeInBytes = packetSize(c_dataSizeInBytes);
+    UINT nBlockAngles = c_nGroupBlocks * g_nAngles;
+    
+    for (UINT index = 0; index < numAdjRanks; index++) {
+        
+        UINT onRankOffset = c_onRankOffsets[index];
+        UINT numPacketsWritten = 
+            fetchCount(onRankOffset + RING_WRITTEN_OFFSET, c_mpiWin);
+        UINT numPacketsToRecv = numPacketsWritten - c_numPacketsRecv[index];
+        if (numPacketsToRecv == 0)
+            continue;
+        Assert(numPacketsToRecv <= c_ringSize);
+        
+        
+        // Get the packets, wrapping around the end of the ring
+        vector<char> &dataPackets = recvBuffers[index];
+        dataPackets.resize(numPacketsToRecv * packetSizeInBytes);
+        char *packets = dataPackets.data();
+        UINT numPacketsLeft = numPacketsToRecv;
+        while (numPacketsLeft > 0) {
+            UINT position = c_numPacketsRecv[index] % c_ringSize;
+            UINT num = min(numPacketsLeft, c_ringSize - position);
+            UINT sizeInBytes = num * packetSizeInBytes;
+            UINT offset = onRankOffset + RING_DATA_OFFSET + 
+                          position * packetSizeInBytes;
+            
+            mpiError = MPI_Get(packets, sizeInBytes, MPI_BYTE, myRank, offset, 
+                               sizeInBytes, MPI_BYTE, c_mpiWin);
+            Insist(mpiError == MPI_SUCCESS, "");
+            
+            packets += sizeInBytes;
+            numPacketsLeft -= num;
+            c_numPacketsRecv[index] += num;
+        }
+        mpiError = MPI_Win_flush_local(myRank, c_mpiWin);
+        Insist(mpiError == MPI_SUCCESS, "");
+        
+        
+        // Give the space back to the sender and unpack
+        putCount(c_numPacketsRecv[index], c_adjRankIndexToRank[index], 
+                 c_offRankOffsets[index] + RING_READ_OFFSET, c_mpiWin);
+        unpackPackets(dataPackets.data(), numPacketsToRecv, packetSizeInBytes,
+                      c_commSides[index], nBlockAngles, traverseData, 
+                      sideRecv);
+    }
+}
+
+
+/*
+    hasOneSidedBacklog
+*/
+bool GraphTraverser::hasOneSidedBacklog() const
+{
+    for (const vector<char> &backlog : c_sendBacklog) {
+        if (backlog.size() > 0)
+            return true;
+    }
+    return false;
+}
+
+
+/*
+    drainOneSided
+
+    Sends what is left in the backlogs after this rank's traversal is done.
+    The adjacent ranks free ring space as they keep traversing, so back off 
+    between attempts instead of spinning on their windows.
+*/
+void GraphTraverser::drainOneSided(
+    const vector<vector<vector<char>>> &emptySendBuffers)
+{
+    UINT backoff = MIN_DRAIN_BACKOFF;
+    while (hasOneSidedBacklog()) {
+        sendOneSided(emptySendBuffers);
+        if (!hasOneSidedBacklog())
+            break;
+        
+        this_thread::sleep_for(chrono::microseconds(backoff));
+        backoff = min(2 * backoff, MAX_DRAIN_BACKOFF);
+    }
+}
+
+
+/*
+    ~GraphTraverser
+*/
+GraphTraverser::~GraphTraverser()
+{
+    if (g_useOneSidedMPI) {
+        MPI_Win_unlock_all(c_mpiWin);
+        MPI_Win_free(&c_mpiWin);
+    }
+    if (c_useNeighborComm) {
+        MPI_Comm_free(&c_neighborComm);
+    }
+    if (c_nodeBuffers != NULL) {
+        delete c_nodeBuffers;
+    }
+    if (c_nodeAggregator != NULL) {
+        delete c_nodeAggregator;
+    }
+}
+
+
+/*
+    computeCellAngle
+    
+    Updates traverseData for the (cell, blockAngle) pair and decrements the
+    dependencies of its children.  Patch seeds with no more dependencies
+    are added to readySeeds.  Data for children on other ranks is added to
+    sendBuffers (indexed by adjacent rank index).
+*/
+template <typename TraverseDataType>
+void GraphTraverser::computeCellAngle(UINT cell, UINT blockAngle, 
+                                      TraverseDataType &traverseData,
+                                      Mat2<UINT> &numDependencies,
+                                      vector<UINT> &readySeeds,
+                                      vector<vector<char>> &sendBuffers)
+{
+    UINT angle = blockAngle % g_nAngles;
+    
+    
+    // Get boundary type and adjacent cell/side data for each face
+    BoundaryType bdryType[g_nFacePerCell];
+    UINT adjCellsSides[g_nFacePerCell];
+    bool isOutgoingWrtDirection[g_nFacePerCell];
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
+        
+        UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+        UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+        adjCellsSides[face] = adjCell;
+        
+        if (g_tychoMesh->isOutgoing(angle, cell, face)) {
+            
+            if (adjCell == TychoMesh::BOUNDARY_FACE && 
+                adjRank != TychoMesh::BAD_RANK)
+            {
+                bdryType[face] = BoundaryType_OutIntBdry;
+                adjCellsSides[face] = 
+                    g_tychoMesh->getSide(cell, face);
+            }
+            
+            else if (adjCell == TychoMesh::BOUNDARY_FACE && 
+                     adjRank == TychoMesh::BAD_RANK)
+            {
+                bdryType[face] = BoundaryType_OutExtBdry;
+            }
+            
+            else {
+                bdryType[face] = BoundaryType_OutInt;
+            }
+            
+            if (c_direction == Direction_Forward) {
+                isOutgoingWrtDirection[face] = true;
+            }
+            else {
+                isOutgoingWrtDirection[face] = false;
+            }
+        }
+        else {
+            
+            if (adjCell == TychoMesh::BOUNDARY_FACE && 
+                adjRank != TychoMesh::BAD_RANK)
+            {
+                bdryType[face] = BoundaryType_InIntBdry;
+                adjCellsSides[face] = 
+                    g_tychoMesh->getSide(cell, face);
+            }
+            
+            else if (adjCell == TychoMesh::BOUNDARY_FACE && 
+                     adjRank == TychoMesh::BAD_RANK)
+            {
+                bdryType[face] = BoundaryType_InExtBdry;
+            }
+            
+            else {
+                bdryType[face] = BoundaryType_InInt;
+            }
+            
+            if (c_direction == Direction_Forward) {
+                isOutgoingWrtDirection[face] = false;
+            }
+            else {
+                isOutgoingWrtDirection[face] = true;
+            }
+        }
+    }
+    
+    
+    // Update data for this cell-angle pair
+    traverseData.update(cell, blockAngle, adjCellsSides, bdryType);
+    
+    
+    // Update dependency for children
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
+        
+        if (isOutgoingWrtDirection[face]) {
+
+            UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+            UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+            
+            // Children in the same patch need no update
+            if (adjCell != TychoMesh::BOUNDARY_FACE &&
+                c_patchSize > 1 &&
+                c_patchBegin(adjCell, angle) == 
+                c_patchBegin(cell, angle))
+            {
+                continue;
+            }
+            
+            if (adjCell != TychoMesh::BOUNDARY_FACE) {
+                UINT seed = getPatchSeed(adjCell, angle);
+                numDependencies(blockAngle, seed)--;
+                if (numDependencies(blockAngle, seed) == 0) {
+                    readySeeds.push_back(seed);
+                }
+            }
+            
+            else if (c_doComm && adjRank != TychoMesh::BAD_RANK) {
+                UINT side = g_tychoMesh->getSide(cell, face);
+                UINT rankIndex = c_sideRankIndex[side];
+                UINT index = c_sideCommIndex[side] * 
+                             c_nGroupBlocks * g_nAngles + blockAngle;
+                
+                appendPacket(sendBuffers[rankIndex], index, c_dataSizeInBytes, 
+                             traverseData.getData(cell, face, blockAngle));
+            }
+        }
+    }
+}
+
+
+/*
+    traverseCommThread
+    
+    Traverses g_tychoMesh with a dedicated communication thread.
+    Threads 0 ... g_nThreads-1 compute their angle group whenever a task is
+    ready.  Thread g_nThreads continuously sends the data computed so far 
+    and passes received side data to the compute threads.
+    
+    Each angle group has an inbox of received (side, blockAngle) pairs and 
+    an outbox of packets for each adjacent rank, each protected by a lock.
+    Only the compute thread of an angle group changes its dependency counts
+    and queue.
+*/
+template <typename TraverseDataType>
+void GraphTraverser::traverseCommThread(TraverseDataType &traverseData)
+{
+    // Angles in the traversal are blockAngle = groupBlock * g_nAngles + angle
+    UINT nBlockAngles = c_nGroupBlocks * g_nAngles;
+    UINT numAdjRanks = c_adjRankIndexToRank.size();
+    vector<priority_queue<Tuple>> canCompute(g_nThreads);
+    Mat2<UINT> numDependencies(nBlockAngles, g_nCells);
+    vector<UINT> numToCalculate(g_nThreads, 0);
+    vector<vector<pair<UINT,UINT>>> inbox(g_nThreads);
+    vector<UINT> inboxSize(g_nThreads, 0);
+    vector<vector<vector<char>>> outbox(g_nThreads, 
+                                        vector<vector<char>>(numAdjRanks));
+    vector<omp_lock_t> inboxLock(g_nThreads);
+    vector<omp_lock_t> outboxLock(g_nThreads);
+    UINT numComputeThreadsDone = 0;
+    CommBuffers commBuffers(g_nThreads, numAdjRanks);
+    Timer totalTimer;
+    Timer setupTimer;
+    Timer commTimer;
+    
+    
+    // Start total timer
+    totalTimer.start();
+    setupTimer.start();
+    
+    
+    // Calc num dependencies and initialize canCompute queue
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT blockAngle = 0; blockAngle < nBlockAngles; blockAngle++) {
+        UINT angle = blockAngle % g_nAngles;
+        UINT angleGroup = angleGroupIndex(angle);
+        numDependencies(blockAngle, cell) = c_initNumDependencies(angle, cell);
+        numToCalculate[angleGroup]++;
+        
+        if (numDependencies(blockAngle, cell) == 0) {
+            UINT priority = getPatchPriority(cell, blockAngle, traverseData);
+            canCompute[angleGroup].push(Tuple(cell, blockAngle, priority));
+        }
+    }}
+    
+    for (UINT angleGroup = 0; angleGroup < g_nThreads; angleGroup++) {
+        omp_init_lock(&inboxLock[angleGroup]);
+        omp_init_lock(&outboxLock[angleGroup]);
+    }
+    
+    if (!g_useOneSidedMPI && !c_useNeighborComm) {
+        startSendAndRecvData(commBuffers, c_adjRankIndexToRank, 
+                             c_numSendPackets, c_numRecvPackets, 
+                             c_nodeBuffers);
+    }
+    
+    
+    // End setup timer
+    setupTimer.stop();
+    
+    
+    // Traverse the graph
+    #pragma omp parallel num_threads(g_nThreads + 1)
+    {
+        Insist(omp_get_num_threads() == (int)g_nThreads + 1, 
+               "Not enough threads for the comm thread.");
+        UINT threadNum = omp_get_thread_num();
+        
+        // Compute threads
+        if (threadNum < g_nThreads) {
+            UINT angleGroup = threadNum;
+            vector<UINT> readySeeds;
+            vector<pair<UINT,UINT>> recvSides;
+            vector<vector<char>> localSendBuffers(numAdjRanks);
+            
+            while (numToCalculate[angleGroup] > 0) {
+                
+                // Update dependencies from received side data
+                UINT numRecv;
+                #pragma omp atomic read
+                numRecv = inboxSize[angleGroup];
+                
+                if (numRecv > 0) {
+                    omp_set_lock(&inboxLock[angleGroup]);
+                    recvSides.swap(inbox[angleGroup]);
+                    #pragma omp atomic write
+                    inboxSize[angleGroup] = 0;
+                    omp_unset_lock(&inboxLock[angleGroup]);
+                    
+                    for (auto sideAngle : recvSides) {
+                        UINT side = sideAngle.first;
+                        UINT blockAngle = sideAngle.second;
+                        UINT angle = blockAngle % g_nAngles;
+                        UINT cell = getPatchSeed(
+                            g_tychoMesh->getSideCell(side), angle);
+                        numDependencies(blockAngle, cell)--;
+                        if (numDependencies(blockAngle, cell) == 0) {
+                            UINT priority = getPatchPriority(
+                                cell, blockAngle, traverseData);
+                            canCompute[angleGroup].push(
+                                Tuple(cell, blockAngle, priority));
+                        }
+                    }
+                    recvSides.clear();
+                }
+                
+                
+                // Wait for work
+                if (canCompute[angleGroup].size() == 0) {
+                    this_thread::yield();
+                    continue;
+                }
+                
+                
+                // Compute the cells of a patch
+                Tuple cellAnglePair = canCompute[angleGroup].top();
+                canCompute[angleGroup].pop();
+                UINT seed = cellAnglePair.getCell();
+                UINT blockAngle = cellAnglePair.getAngle();
+                UINT angle = blockAngle % g_nAngles;
+                
+                UINT patchBegin = seed;
+                UINT patchEnd = seed + 1;
+                if (c_patchSize > 1) {
+                    patchBegin = c_patchBegin(seed, angle);
+                    patchEnd = c_patchEnd(seed, angle);
+                }
+                
+                for (UINT index = patchBegin; index < patchEnd; index++) {
+                    UINT cell = index;
+                    if (c_patchSize > 1)
+                        cell = c_patchCells(index, angle);
+                    
+                    readySeeds.clear();
+                    computeCellAngle(cell, blockAngle, traverseData, 
+                                     numDependencies, readySeeds, 
+                                     localSendBuffers);
+                    for (UINT readySeed : readySeeds) {
+                        UINT priority = getPatchPriority(
+                            readySeed, blockAngle, traverseData);
+                        canCompute[angleGroup].push(
+                            Tuple(readySeed, blockAngle, priority));
+                    }
+                }
+                numToCalculate[angleGroup] -= patchEnd - patchBegin;
+                
+                
+                // Pass data for other ranks to the comm thread
+                omp_set_lock(&outboxLock[angleGroup]);
+                for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+                    outbox[angleGroup][rankIndex].insert(
+                        outbox[angleGroup][rankIndex].end(), 
+                        localSendBuffers[rankIndex].begin(), 
+                        localSendBuffers[rankIndex].end());
+                    localSendBuffers[rankIndex].clear();
+                }
+                omp_unset_lock(&outboxLock[angleGroup]);
+            }
+            
+            #pragma omp atomic
+            numComputeThreadsDone++;
+        }
         
-        c_initNumDependencies(angle, cell) = 0;
-        for (UINT face = 0; face < g_nFacePerCell; face++) {
-            
-            bool incoming = isIncoming(angle, cell, face, c_direction);
-            UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
-            UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
-            
-            if (c_doComm && incoming && adjRank != TychoMesh::BAD_RANK) {
-                c_initNumDependencies(angle, cell)++;
-            }
-            else if (!c_doComm && incoming && adjCell != TychoMesh::BOUNDARY_FACE) {
-                c_initNumDependencies(angle, cell)++;
+        // Comm thread
+        // With neighborhood collectives, it continues until all ranks 
+        // are done.
+        else {
+            bool computeDone = false;
+            bool allDone = false;
+            while (c_useNeighborComm ? !allDone : !computeDone) {
+                
+                // Check before collecting the outboxes so the last data 
+                // from the compute threads is sent
+                UINT numDone;
+                #pragma omp atomic read
+                numDone = numComputeThreadsDone;
+                computeDone = (numDone == g_nThreads);
+                
+                
+                // Collect data from compute threads
+                // The outboxes are swapped with the (empty) send buffers,
+                // so the data is not copied.  Send buffers held for 
+                // coalescing are appended to instead.
+                bool newData = false;
+                for (UINT angleGroup = 0; angleGroup < g_nThreads; 
+                     angleGroup++) 
+                {
+                    omp_set_lock(&outboxLock[angleGroup]);
+                    for (UINT rankIndex = 0; rankIndex < numAdjRanks; 
+                         rankIndex++) 
+                    {
+                        vector<char> &sendBuffer = 
+                            commBuffers.sendBuffers[angleGroup][rankIndex];
+                        vector<char> &outboxBuffer = 
+                            outbox[angleGroup][rankIndex];
+                        if (outboxBuffer.size() > 0)
+                            newData = true;
+                        if (sendBuffer.size() == 0) {
+                            outboxBuffer.swap(sendBuffer);
+                        }
+                        else {
+                            sendBuffer.insert(sendBuffer.end(), 
+                                              outboxBuffer.begin(), 
+                                              outboxBuffer.end());
+                            outboxBuffer.clear();
+                        }
+                    }
+                    omp_unset_lock(&outboxLock[angleGroup]);
+                }
+                
+                
+                // Send/Recv
+                commTimer.start();
+                commBuffers.sideRecv.clear();
+                if (c_useNeighborComm) {
+                    neighborSendAndRecvData(commBuffers, c_neighborComm, 
+                                            traverseData, c_dataSizeInBytes, 
+                                            c_commSides, nBlockAngles, 
+                                            c_nodeAggregator, computeDone, 
+                                            allDone);
+                }
+                else if (!g_useOneSidedMPI) {
+                    // Held data is sent once the compute threads stop 
+                    // adding to it, since they may be waiting for data
+                    const bool block = false;
+                    const bool flushAll = computeDone || !newData;
+                    sendAndRecvData(commBuffers, c_adjRankIndexToRank, 
+                                    traverseData, c_dataSizeInBytes, 
+                                    c_commSides, nBlockAngles, 
+                                    c_nodeBuffers, block, flushAll);
+                }
+                else {
+                    sendOneSided(commBuffers.sendBuffers);
+                    recvOneSided(traverseData, commBuffers.recvBuffers, 
+                                 commBuffers.sideRecv);
+                }
+                commTimer.stop();
+                
+                commBuffers.clearSendBuffers();
+                
+                
+                // Pass received side data to compute threads
+                for (auto sideAngle : commBuffers.sideRecv) {
+                    UINT angleGroup = 
+                        angleGroupIndex(sideAngle.second % g_nAngles);
+                    omp_set_lock(&inboxLock[angleGroup]);
+                    inbox[angleGroup].push_back(sideAngle);
+                    #pragma omp atomic write
+                    inboxSize[angleGroup] = inbox[angleGroup].size();
+                    omp_unset_lock(&inboxLock[angleGroup]);
+                }
             }
+            
+            if (g_useOneSidedMPI)
+                drainOneSided(commBuffers.sendBuffers);
         }
-    }}
-
-
-    // Setup one-sided MPI
-    if (g_useOneSidedMPI) {
-        setupOneSidedMPI();
     }
-}
-
-
-/*
-    setupOneSidedMPI
-*/
-void GraphTraverser::setupOneSidedMPI()
-{
-    int mpiError;
-    c_maxPackets = 10 * g_maxCellsPerStep;
     
-    
-    // Allocate MPI_Win
-    UINT numAdjRanks = c_adjRankIndexToRank.size();
-    UINT packetSize = 2 * sizeof(UINT) + c_dataSizeInBytes;
-    UINT windowSizeInBytes = 
-        (16 + 2 * c_maxPackets * packetSize) * numAdjRanks;
-    MPI_Info mpiInfo;
-    MPI_Info_create(&mpiInfo);
-    MPI_Info_set(mpiInfo, "accumulate_ops", "same_op_no_op");
-    MPI_Win_allocate(windowSizeInBytes, 1, mpiInfo, 
-                     MPI_COMM_WORLD, &c_mpiWinMemory, &c_mpiWin);
-    MPI_Info_free(&mpiInfo);
-
-
-    // Setup onRankOffsets
-    c_onRankOffsets.resize(numAdjRanks);
-    for (UINT i = 0; i < numAdjRanks; i++) {
-        c_onRankOffsets[i] = i * (16 + 2 * c_maxPackets * packetSize);
+    for (UINT angleGroup = 0; angleGroup < g_nThreads; angleGroup++) {
+        omp_destroy_lock(&inboxLock[angleGroup]);
+        omp_destroy_lock(&outboxLock[angleGroup]);
     }
-
-
-    // Setup offRankOffsets
-    c_offRankOffsets.resize(numAdjRanks);
-    vector<MPI_Request> mpiSendRequests(numAdjRanks);
-    vector<MPI_Request> mpiRecvRequests(numAdjRanks);
-    for (UINT i = 0; i < numAdjRanks; i++) {
-        UINT adjRank = c_adjRankIndexToRank[i];
-        int tag = 0;
-        
-        // Send index
-        mpiError = MPI_Isend(&c_onRankOffsets[i], 1, MPI_UINT64_T, adjRank, 
-                             tag, MPI_COMM_WORLD, &mpiSendRequests[i]);
-        Insist(mpiError == MPI_SUCCESS, "");
-
-        // Recv index
-        mpiError = MPI_Irecv(&c_offRankOffsets[i], 1, MPI_UINT64_T, adjRank, 
-                             tag, MPI_COMM_WORLD, &mpiRecvRequests[i]);
-        Insist(mpiError == MPI_SUCCESS, "");
+    
+    
+    // All data has been sent and received (see sendAndRecvData)
+    if (!g_useOneSidedMPI && !c_useNeighborComm) {
+        for (UINT index = 0; index < numAdjRanks; index++) {
+            Assert(commBuffers.numSendRemaining[index] == 0);
+            Assert(commBuffers.numRecvRemaining[index] == 0);
+        }
     }
     
+    
+    // Print times
+    totalTimer.stop();
 
-    // Wait for messages to send/recv
-    if (numAdjRanks > 0) {
-        mpiError = MPI_Waitall(mpiSendRequests.size(), mpiSendRequests.data(), 
-                               MPI_STATUSES_IGNORE);
-        Insist(mpiError == MPI_SUCCESS, "");
-        
-        mpiError = MPI_Waitall(mpiRecvRequests.size(), mpiRecvRequests.data(), 
-                               MPI_STATUSES_IGNORE);
-        Insist(mpiError == MPI_SUCCESS, "");
-    }
+    double totalTime = totalTimer.wall_clock();
+    Comm::gmax(totalTime);
 
+    double setupTime = setupTimer.wall_clock();
+    Comm::gmax(setupTime);
 
-    // Lock the window to start RMA operations and set memory to zero
-    MPI_Win_lock_all(MPI_MODE_NOCHECK, c_mpiWin);
-    memset(c_mpiWinMemory, 0, windowSizeInBytes);
-    MPI_Win_sync(c_mpiWin);
-    Comm::barrier();
+    double commTime = commTimer.sum_wall_clock();
+    Comm::gmax(commTime);
     
-
-    // Print out use of one-sided MPI
     if (Comm::rank() == 0) {
-        if (g_useOneSidedMPI)
-            printf("Using one-sided MPI.\n");
-        else
-            printf("NOT using one-sided MPI.\n");
-    }
-}
-
-
-/*
-    ~GraphTraverser
-*/
-GraphTraverser::~GraphTraverser()
-{
-    if (g_useOneSidedMPI) {
-        MPI_Win_unlock_all(c_mpiWin);
-        MPI_Win_free(&c_mpiWin);
+        printf("      Traverse Timer (comm thread):   %fs\n", commTime);
+        printf("      Traverse Timer (setup):         %fs\n", setupTime);
+        printf("      Traverse Timer (total):         %fs\n", totalTime);
     }
 }
 
@@ -749,21 +2432,43 @@ GraphTraverser::~GraphTraverser()
     
     Traverses g_tychoMesh.
 */
+template <typename TraverseDataType>
 void GraphTraverser::traverse(const UINT maxComputePerStep,
-                              TraverseData &traverseData)
+                              TraverseDataType &traverseData)
 {
+    if (g_useCommThread && c_doComm) {
+        traverseCommThread(traverseData);
+        return;
+    }
+    
+    
+    // Angles in the traversal are blockAngle = groupBlock * g_nAngles + angle
+    UINT nBlockAngles = c_nGroupBlocks * g_nAngles;
     vector<priority_queue<Tuple>> canCompute(g_nThreads);
-    Mat2<UINT> numDependencies(g_nAngles, g_nCells);
-    UINT numCellAnglePairsToCalculate = g_nAngles * g_nCells;
-    set<pair<UINT,UINT>> sideRecv;
-    Mat2<vector<char>> sendBuffers;
-    vector<vector<char>> sendBuffers1;
-    vector<bool> commDark;
+    Mat2<UINT> numDependencies(nBlockAngles, g_nCells);
+    UINT numCellAnglePairsToCalculate = nBlockAngles * g_nCells;
+    UINT numAdjRanks = c_adjRankIndexToRank.size();
+    CommBuffers commBuffers(g_nThreads, numAdjRanks);
+    vector<UINT> patchIndex(g_nThreads, 0);
+    vector<UINT> patchEnd(g_nThreads, 0);
+    vector<UINT> patchBlockAngle(g_nThreads, 0);
+    bool useHints = g_useStarvationHints && c_doComm && 
+                    !g_useOneSidedMPI && !c_useNeighborComm;
+    StarvationHints hints(nBlockAngles, useHints ? g_nCells : 0, g_nThreads, 
+                          numAdjRanks);
     Timer totalTimer;
     Timer setupTimer;
     Timer commTimer;
     Timer sendTimer;
     Timer recvTimer;
+    Timer idleTimer;
+    Timer stepComputeTimer;
+    Timer stepCommTimer;
+    UINT stepSize = maxComputePerStep;
+    UINT numSteps = 0;
+    UINT minStepSize = stepSize;
+    UINT maxStepSize = stepSize;
+    double sumStepSize = 0.0;
     
 
     // Start total timer
@@ -773,27 +2478,30 @@ void GraphTraverser::traverse(const UINT maxComputePerStep,
     
     // Calc num dependencies for each (cell, angle) pair
     for (UINT cell = 0; cell < g_nCells; cell++) {
-    for (UINT angle = 0; angle < g_nAngles; angle++) {
-        numDependencies(angle, cell) = c_initNumDependencies(angle, cell);
+    for (UINT blockAngle = 0; blockAngle < nBlockAngles; blockAngle++) {
+        UINT angle = blockAngle % g_nAngles;
+        numDependencies(blockAngle, cell) = c_initNumDependencies(angle, cell);
     }}
     
     
-    // Set size of sendBuffers and commDark
-    UINT numAdjRanks = c_adjRankIndexToRank.size();
-    sendBuffers.resize(g_nThreads, numAdjRanks);
-    sendBuffers1.resize(numAdjRanks);
-    commDark.resize(numAdjRanks, false);
-    
-    
     // Initialize canCompute queue
     for (UINT cell = 0; cell < g_nCells; cell++) {
-    for (UINT angle = 0; angle < g_nAngles; angle++) {
-        if (numDependencies(angle, cell) == 0) {
-            UINT priority = traverseData.getPriority(cell, angle);
-            UINT angleGroup = angleGroupIndex(angle);
-            canCompute[angleGroup].push(Tuple(cell, angle, priority));
+    for (UINT blockAngle = 0; blockAngle < nBlockAngles; blockAngle++) {
+        if (numDependencies(blockAngle, cell) == 0) {
+            UINT priority = getPatchPriority(cell, blockAngle, traverseData);
+            UINT angleGroup = angleGroupIndex(blockAngle % g_nAngles);
+            canCompute[angleGroup].push(Tuple(cell, blockAngle, priority));
         }
     }}
+    
+    if (c_doComm && !g_useOneSidedMPI && !c_useNeighborComm) {
+        startSendAndRecvData(commBuffers, c_adjRankIndexToRank, 
+                             c_numSendPackets, c_numRecvPackets, 
+                             c_nodeBuffers);
+    }
+    
+    if (useHints)
+        setupStarvationHints(hints, traverseData);
 
 
     // End setup timer
@@ -801,214 +2509,268 @@ void GraphTraverser::traverse(const UINT maxComputePerStep,
     
     
     // Traverse the graph
-    while (numCellAnglePairsToCalculate > 0) {
+    // One thread team is used for the whole traversal.  Each step, every
+    // thread computes for its angle group, then the master thread sends
+    // each thread's buffers and communicates while the others wait.
+    // done is only set by the master thread between barriers, so all 
+    // threads agree on it.  With neighborhood collectives, every rank 
+    // takes steps until all ranks are done.
+    bool done = (numCellAnglePairsToCalculate == 0) && !c_useNeighborComm;
+    bool neighborDone = false;
+    #pragma omp parallel
+    {
+    vector<UINT> readySeeds;    // Per thread, reused every step
+    while (!done) {
+        
+        // Record step size
+        #pragma omp master
+        {
+            numSteps++;
+            sumStepSize += stepSize;
+            minStepSize = min(minStepSize, stepSize);
+            maxStepSize = max(maxStepSize, stepSize);
+            stepComputeTimer.start();
+        }
+        
         
         // Do local traversal
-        #pragma omp parallel
         {
             UINT stepsTaken = 0;
             UINT angleGroup = omp_get_thread_num();
-            while (canCompute[angleGroup].size() > 0 && 
-                   stepsTaken < maxComputePerStep)
+            vector<priority_queue<Tuple>> &urgent = hints.urgent;
+            while ((canCompute[angleGroup].size() > 0 || 
+                    urgent[angleGroup].size() > 0 ||
+                    patchIndex[angleGroup] < patchEnd[angleGroup]) && 
+                   stepsTaken < stepSize)
             {
                 // Get cell/angle pair to compute
-                Tuple cellAnglePair = canCompute[angleGroup].top();
-                canCompute[angleGroup].pop();
-                UINT cell = cellAnglePair.getCell();
-                UINT angle = cellAnglePair.getAngle();
-                stepsTaken++;
-                
-                #pragma omp atomic
-                numCellAnglePairsToCalculate--;
-                
-                
-                // Get boundary type and adjacent cell/side data for each face
-                BoundaryType bdryType[g_nFacePerCell];
-                UINT adjCellsSides[g_nFacePerCell];
-                bool isOutgoingWrtDirection[g_nFacePerCell];
-                for (UINT face = 0; face < g_nFacePerCell; face++) {
+                // If using patches, the cells of the current patch are
+                // computed in order before the next patch is started.
+                // Seeds boosted by starvation hints are computed first.
+                if (patchIndex[angleGroup] == patchEnd[angleGroup]) {
+                    priority_queue<Tuple> &queue = 
+                        urgent[angleGroup].size() > 0 ? 
+                        urgent[angleGroup] : canCompute[angleGroup];
+                    Tuple cellAnglePair = queue.top();
+                    queue.pop();
+                    UINT cell = cellAnglePair.getCell();
+                    UINT blockAngle = cellAnglePair.getAngle();
+                    UINT angle = blockAngle % g_nAngles;
                     
-                    UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
-                    UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
-                    adjCellsSides[face] = adjCell;
+                    if (useHints) {
+                        if (hints.isDone(blockAngle, cell))
+                            continue;
+                        hints.isDone(blockAngle, cell) = 1;
+                    }
                     
-                    if (g_tychoMesh->isOutgoing(angle, cell, face)) {
-                        
-                        if (adjCell == TychoMesh::BOUNDARY_FACE && 
-                            adjRank != TychoMesh::BAD_RANK)
-                        {
-                            bdryType[face] = BoundaryType_OutIntBdry;
-                            adjCellsSides[face] = 
-                                g_tychoMesh->getSide(cell, face);
-                        }
-                        
-                        else if (adjCell == TychoMesh::BOUNDARY_FACE && 
-                                 adjRank == TychoMesh::BAD_RANK)
-                        {
-                            bdryType[face] = BoundaryType_OutExtBdry;
-                        }
-                        
-                        else {
-                            bdryType[face] = BoundaryType_OutInt;
-                        }
-                        
-                        if (c_direction == Direction_Forward) {
-                            isOutgoingWrtDirection[face] = true;
-                        }
-                        else {
-                            isOutgoingWrtDirection[face] = false;
-                        }
+                    if (c_patchSize > 1) {
+                        patchIndex[angleGroup] = c_patchBegin(cell, angle);
+                        patchEnd[angleGroup] = c_patchEnd(cell, angle);
                     }
                     else {
-                        
-                        if (adjCell == TychoMesh::BOUNDARY_FACE && 
-                            adjRank != TychoMesh::BAD_RANK)
-                        {
-                            bdryType[face] = BoundaryType_InIntBdry;
-                            adjCellsSides[face] = 
-                                g_tychoMesh->getSide(cell, face);
-                        }
-                        
-                        else if (adjCell == TychoMesh::BOUNDARY_FACE && 
-                                 adjRank == TychoMesh::BAD_RANK)
-                        {
-                            bdryType[face] = BoundaryType_InExtBdry;
-                        }
-                        
-                        else {
-                            bdryType[face] = BoundaryType_InInt;
-                        }
-                        
-                        if (c_direction == Direction_Forward) {
-                            isOutgoingWrtDirection[face] = false;
-                        }
-                        else {
-                            isOutgoingWrtDirection[face] = true;
-                        }
+                        // Each cell is its own patch
+                        patchIndex[angleGroup] = cell;
+                        patchEnd[angleGroup] = cell + 1;
                     }
+                    patchBlockAngle[angleGroup] = blockAngle;
                 }
                 
+                UINT blockAngle = patchBlockAngle[angleGroup];
+                UINT angle = blockAngle % g_nAngles;
+                UINT cell = patchIndex[angleGroup];
+                if (c_patchSize > 1)
+                    cell = c_patchCells(patchIndex[angleGroup], angle);
+                patchIndex[angleGroup]++;
+                stepsTaken++;
                 
-                // Update data for this cell-angle pair
-                traverseData.update(cell, angle, adjCellsSides, bdryType);
+                #pragma omp atomic
+                numCellAnglePairsToCalculate--;
                 
                 
-                // Update dependency for children
-                for (UINT face = 0; face < g_nFacePerCell; face++) {
-                    
-                    if (isOutgoingWrtDirection[face]) {
-
-                        UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
-                        UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
-                        
-                        if (adjCell != TychoMesh::BOUNDARY_FACE) {
-                            numDependencies(angle, adjCell)--;
-                            if (numDependencies(angle, adjCell) == 0) {
-                                UINT priority = 
-                                    traverseData.getPriority(adjCell, angle);
-                                Tuple tuple(adjCell, angle, priority);
-                                canCompute[angleGroup].push(tuple);
-                            }
-                        }
-                        
-                        else if (c_doComm && adjRank != TychoMesh::BAD_RANK) {
-                            UINT rankIndex = c_adjRankToRankIndex.at(adjRank);
-                            UINT side = g_tychoMesh->getSide(cell, face);
-                            UINT globalSide = g_tychoMesh->getLGSide(side);
-                            
-                            vector<char> packet;
-                            createPacket(packet, globalSide, angle, 
-                                         c_dataSizeInBytes, 
-                                         traverseData.getData(cell, face, angle));
-                            
-                            sendBuffers(angleGroup, rankIndex).insert(
-                                sendBuffers(angleGroup, rankIndex).end(), 
-                                packet.begin(), packet.end());
-                        }
+                // Compute and update dependencies
+                readySeeds.clear();
+                computeCellAngle(cell, blockAngle, traverseData, 
+                                 numDependencies, readySeeds, 
+                                 commBuffers.sendBuffers[angleGroup]);
+                for (UINT seed : readySeeds) {
+                    UINT priority = getPatchPriority(seed, blockAngle, 
+                                                     traverseData);
+                    if (useHints && hints.isBoosted(blockAngle, seed)) {
+                        urgent[angleGroup].push(
+                            Tuple(seed, blockAngle, priority));
+                    }
+                    else {
+                        canCompute[angleGroup].push(
+                            Tuple(seed, blockAngle, priority));
                     }
                 }
             }
         }
         
         
-        // Put together sendBuffers from different angleGroups
-        for (UINT angleGroup = 0; angleGroup < g_nThreads; angleGroup++) {
-        for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
-            sendBuffers1[rankIndex].insert(
-                sendBuffers1[rankIndex].end(), 
-                sendBuffers(angleGroup, rankIndex).begin(), 
-                sendBuffers(angleGroup, rankIndex).end());
-        }}
-               
+        #pragma omp barrier
+        
+        
+        // Communicate with master thread (MPI_THREAD_FUNNELED)
+        #pragma omp master
+        {
+            stepComputeTimer.stop();
         
-        // Do communication
-        commTimer.start();
-        if (c_doComm) {
+        
+            // Do communication
+            commTimer.start();
+            stepCommTimer.start();
+            if (c_doComm) {
             
-            // Send/Recv
-            sideRecv.clear();
+                // Send/Recv
+                commBuffers.sideRecv.clear();
             
-            if (!g_useOneSidedMPI) {
-                const bool killComm = false;
-                sendAndRecvData(sendBuffers1, c_adjRankIndexToRank, traverseData, 
-                                c_dataSizeInBytes, sideRecv, commDark, killComm);
-            }
-            else {
-                UINT packetSizeInBytes = 2 * sizeof(UINT) + c_dataSizeInBytes;
-                static bool firstTime = true;
-
-                sendTimer.start();
-                sendData(sendBuffers1, c_adjRankIndexToRank, c_offRankOffsets, 
-                         packetSizeInBytes, c_maxPackets, c_mpiWin, firstTime);
-                sendTimer.stop();
-
-                recvTimer.start();
-                recvData(c_adjRankIndexToRank.size(), c_onRankOffsets, 
-                         packetSizeInBytes, traverseData, sideRecv, 
-                         c_maxPackets, c_mpiWin, firstTime);
-                recvTimer.stop();
-
-                firstTime = false;
-            }
+                if (c_useNeighborComm) {
+                    bool localDone = (numCellAnglePairsToCalculate == 0);
+                    bool allDone;
+                    neighborSendAndRecvData(commBuffers, c_neighborComm, 
+                                            traverseData, c_dataSizeInBytes, 
+                                            c_commSides, nBlockAngles, 
+                                            c_nodeAggregator, localDone, 
+                                            allDone);
+                    neighborDone = allDone;
+                }
+                else if (!g_useOneSidedMPI) {
+                    // Wait for data if there is nothing to compute
+                    bool block = (numCellAnglePairsToCalculate > 0);
+                    UINT numReady = 0;
+                    for (UINT angleGroup = 0; angleGroup < g_nThreads; 
+                         angleGroup++) 
+                    {
+                        if (canCompute[angleGroup].size() > 0 || 
+                            hints.urgent[angleGroup].size() > 0 ||
+                            patchIndex[angleGroup] < patchEnd[angleGroup])
+                        {
+                            block = false;
+                        }
+                        numReady += (canCompute[angleGroup].size() + 
+                                     hints.urgent[angleGroup].size()) * 
+                                    c_patchSize + 
+                                    patchEnd[angleGroup] - 
+                                    patchIndex[angleGroup];
+                    }
+                    
+                    // Ask for the data needed most if there is not a full
+                    // step of work left
+                    if (useHints) {
+                        bool starved = (numCellAnglePairsToCalculate > 0) &&
+                                       (numReady < stepSize * g_nThreads);
+                        setSendHints(hints, starved, commBuffers.sendHints);
+                    }
+                    
+                    // Send held data before waiting or finishing
+                    bool flushAll = block || 
+                                    (numCellAnglePairsToCalculate == 0);
+                    if (block)
+                        idleTimer.start();
+                    sendAndRecvData(commBuffers, c_adjRankIndexToRank, 
+                                    traverseData, c_dataSizeInBytes, 
+                                    c_commSides, nBlockAngles, 
+                                    c_nodeBuffers, block, flushAll);
+                    if (block)
+                        idleTimer.stop();
+                }
+                else {
+                    sendTimer.start();
+                    sendOneSided(commBuffers.sendBuffers);
+                    sendTimer.stop();
+
+                    recvTimer.start();
+                    recvOneSided(traverseData, commBuffers.recvBuffers, 
+                                 commBuffers.sideRecv);
+                    recvTimer.stop();
+                }
 
             
-            // Clear send buffers for next iteration
-            for (UINT angleGroup = 0; angleGroup < g_nThreads; angleGroup++) {
-            for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
-                sendBuffers(angleGroup, rankIndex).clear();
-            }}
-            
-            for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
-                sendBuffers1[rankIndex].clear();
-            }
+                // Clear send buffers for next iteration
+                commBuffers.clearSendBuffers();
             
             
-            // Update dependency for parents using received side data
-            for (auto sideAngle : sideRecv) {
-                UINT side = sideAngle.first;
-                UINT angle = sideAngle.second;
-                UINT cell = g_tychoMesh->getSideCell(side);
-                numDependencies(angle, cell)--;
-                if (numDependencies(angle, cell) == 0) {
-                    UINT priority = traverseData.getPriority(cell, angle);
-                    Tuple tuple(cell, angle, priority);
-                    canCompute[angleGroupIndex(angle)].push(tuple);
+                // Update dependency for parents using received side data
+                for (auto sideAngle : commBuffers.sideRecv) {
+                    UINT side = sideAngle.first;
+                    UINT blockAngle = sideAngle.second;
+                    UINT angle = blockAngle % g_nAngles;
+                    UINT cell = 
+                        getPatchSeed(g_tychoMesh->getSideCell(side), angle);
+                    numDependencies(blockAngle, cell)--;
+                    if (numDependencies(blockAngle, cell) == 0) {
+                        UINT priority = getPatchPriority(cell, blockAngle, 
+                                                         traverseData);
+                        Tuple tuple(cell, blockAngle, priority);
+                        if (useHints && hints.isBoosted(blockAngle, cell))
+                            hints.urgent[angleGroupIndex(angle)].push(tuple);
+                        else
+                            canCompute[angleGroupIndex(angle)].push(tuple);
+                    }
+                    
+                    if (useHints) {
+                        UINT index = c_sideCommIndex[side] * nBlockAngles + 
+                                     blockAngle;
+                        hints.isRecv[c_sideRankIndex[side]][index] = 1;
+                    }
+                }
+                
+                
+                // Boost the work adjacent ranks are starved for
+                for (auto rankIndexHint : commBuffers.recvHints) {
+                    UINT rankIndex = rankIndexHint.first;
+                    UINT hint = rankIndexHint.second;
+                    Assert(hint / nBlockAngles < c_commSides[rankIndex].size());
+                    UINT side = c_commSides[rankIndex][hint / nBlockAngles];
+                    UINT blockAngle = hint % nBlockAngles;
+                    hints.numRecv++;
+                    boostUpstream(hints, g_tychoMesh->getSideCell(side), 
+                                  blockAngle, numDependencies, 
+                                  max(stepSize / c_patchSize, (UINT)1), 
+                                  traverseData);
+                }
+            }
+            stepCommTimer.stop();
+            commTimer.stop();
+        
+        
+            // Adapt step size using the smallest per thread queue
+            if (g_adaptiveCellsPerStep) {
+                UINT queueDepth = UINT64_MAX;
+                for (UINT angleGroup = 0; angleGroup < g_nThreads; 
+                     angleGroup++) 
+                {
+                    queueDepth = min(queueDepth, 
+                                     (UINT)canCompute[angleGroup].size() * 
+                                     c_patchSize);
                 }
+                stepSize = adaptStepSize(stepSize, maxComputePerStep, 
+                                         stepComputeTimer.wall_clock(), 
+                                         stepCommTimer.wall_clock(), 
+                                         queueDepth);
             }
+            
+            done = (numCellAnglePairsToCalculate == 0);
+            if (c_useNeighborComm)
+                done = neighborDone;
         }
-        commTimer.stop();
+        #pragma omp barrier
+    }
     }
     
     
-    // Send kill comm signal to adjacent ranks
-    if (!g_useOneSidedMPI) {
-        commTimer.start();
-        if (c_doComm) {
-            const bool killComm = true;
-            sendAndRecvData(sendBuffers1, c_adjRankIndexToRank, traverseData, 
-                            c_dataSizeInBytes, sideRecv, commDark, killComm);
+    // Send packets that did not fit in the adjacent ranks' ring buffers
+    if (c_doComm && g_useOneSidedMPI)
+        drainOneSided(commBuffers.sendBuffers);
+    
+    
+    // All data has been sent and received (see sendAndRecvData)
+    if (c_doComm && !g_useOneSidedMPI && !c_useNeighborComm) {
+        for (UINT index = 0; index < numAdjRanks; index++) {
+            Assert(commBuffers.numSendRemaining[index] == 0);
+            Assert(commBuffers.numRecvRemaining[index] == 0);
         }
-        commTimer.stop();
     }
 
     
@@ -1030,14 +2792,79 @@ void GraphTraverser::traverse(const UINT maxComputePerStep,
     double recvTime = recvTimer.sum_wall_clock();
     Comm::gmax(recvTime);
     
+    double idleTime = idleTimer.sum_wall_clock();
+    double totalIdleTime = idleTime;
+    Comm::gmax(idleTime);
+    Comm::gsum(totalIdleTime);
+    
     if (Comm::rank() == 0) {
         printf("      Traverse Timer (comm):    %fs\n", commTime);
         printf("      Traverse Timer (send):    %fs\n", sendTime);
         printf("      Traverse Timer (recv):    %fs\n", recvTime);
+        printf("      Traverse Timer (idle):    %fs (sum over ranks %fs)\n", 
+               idleTime, totalIdleTime);
         printf("      Traverse Timer (setup):   %fs\n", setupTime);
         printf("      Traverse Timer (total):   %fs\n", totalTime);
     }
+    
+    
+    // Print starvation hints received, seeds boosted and hints sent 
+    // without data
+    if (useHints) {
+        Comm::gsum(hints.numRecv);
+        Comm::gsum(hints.numBoosted);
+        Comm::gsum(commBuffers.numHintOnlySent);
+        if (Comm::rank() == 0) {
+            printf("      Traverse Starvation Hints "
+                   "(recv/boosted/sent without data):   %" PRIu64 "  %" 
+                   PRIu64 "  %" PRIu64 "\n", hints.numRecv, 
+                   hints.numBoosted, commBuffers.numHintOnlySent);
+        }
+    }
+    
+    
+    // Print chosen step sizes
+    if (g_adaptiveCellsPerStep) {
+        UINT maxNumSteps = numSteps;
+        Comm::gmax(maxNumSteps);
+        Comm::gsum(sumStepSize);
+        Comm::gsum(numSteps);
+        Comm::gmax(maxStepSize);
+        
+        // min = -max(-x)
+        double minStepSizeDouble = -(double)minStepSize;
+        Comm::gmax(minStepSizeDouble);
+        
+        if (Comm::rank() == 0) {
+            printf("      Traverse Step Size (min/avg/max):   %.0f  %.1f  %" 
+                   PRIu64 "\n", -minStepSizeDouble, sumStepSize / numSteps, 
+                   maxStepSize);
+            printf("      Traverse Num Steps:   %" PRIu64 "\n", maxNumSteps);
+        }
+    }
 }
 
 
+/*
+    traverse
+    
+    Traverses g_tychoMesh using virtual calls to traverseData.
+*/
+void GraphTraverser::traverse(const UINT maxComputePerStep,
+                              TraverseData &traverseData)
+{
+    traverse<TraverseData>(maxComputePerStep, traverseData);
+}
+
 
+// Compile traverse for each TraverseData subclass
+template void GraphTraverser::traverse<SweepData>(
+    const UINT maxComputePerStep, SweepData &traverseData);
+template void GraphTraverser::traverse<MultiSweepData>(
+    const UINT maxComputePerStep, MultiSweepData &traverseData);
+template void GraphTraverser::traverse<BLevelData>(
+    const UINT maxComputePerStep, BLevelData &traverseData);
+template void GraphTraverser::traverse<NeighborPriorityData>(
+    const UINT maxComputePerStep, NeighborPriorityData &traverseData);
+template void GraphTraverser::traverse<RemotePriorityData>(
+    const UINT maxComputePerStep, RemotePriorityData &traverseData);
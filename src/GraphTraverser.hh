@@ -45,6 +45,12 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <mpi.h>
 #include <vector>
 #include <map>
+#include <utility>
+
+
+class NodeBuffers;
+class NodeAggregator;
+struct StarvationHints;
 
 /*
     Boundary Type for faces of a cell.
@@ -97,13 +103,51 @@ protected:
 class GraphTraverser
 {
 public:
-    GraphTraverser(Direction direction, bool doComm, UINT dataSizeInBytes);
+    GraphTraverser(Direction direction, bool doComm, UINT dataSizeInBytes,
+                   UINT nGroupBlocks = 1);
     ~GraphTraverser();
 
+    // traverse is compiled for each TraverseData subclass, so calls to 
+    // the data in the inner loop are not virtual.  Calling with a 
+    // TraverseData reference uses virtual calls.
+    template <typename TraverseDataType>
+    void traverse(const UINT maxComputePerStep, 
+                  TraverseDataType &traverseData);
     void traverse(const UINT maxComputePerStep, TraverseData &traverseData);
 
 private:
     void setupOneSidedMPI();
+    void putPackets(const char *packets, UINT numPackets, 
+                    const UINT rankIndex);
+    void sendOneSided(
+        const std::vector<std::vector<std::vector<char>>> &sendBuffers);
+    void recvOneSided(TraverseData &traverseData,
+                      std::vector<std::vector<char>> &recvBuffers,
+                      std::vector<std::pair<UINT,UINT>> &sideRecv);
+    bool hasOneSidedBacklog() const;
+    void drainOneSided(
+        const std::vector<std::vector<std::vector<char>>> &emptySendBuffers);
+    void setupCommSides();
+    void setupPatches();
+    UINT getPatchSeed(UINT cell, UINT angle);
+    template <typename TraverseDataType>
+    void traverseCommThread(TraverseDataType &traverseData);
+    template <typename TraverseDataType>
+    void computeCellAngle(UINT cell, UINT blockAngle, 
+                          TraverseDataType &traverseData,
+                          Mat2<UINT> &numDependencies,
+                          std::vector<UINT> &readySeeds,
+                          std::vector<std::vector<char>> &sendBuffers);
+    template <typename TraverseDataType>
+    UINT getPatchPriority(UINT cell, UINT blockAngle, 
+                          TraverseDataType &traverseData);
+    template <typename TraverseDataType>
+    void setupStarvationHints(StarvationHints &hints, 
+                              TraverseDataType &traverseData);
+    template <typename TraverseDataType>
+    void boostUpstream(StarvationHints &hints, UINT cell, UINT blockAngle, 
+                       const Mat2<UINT> &numDependencies, UINT maxSeeds, 
+                       TraverseDataType &traverseData);
     
     std::vector<UINT> c_adjRankIndexToRank;
     std::map<UINT,UINT> c_adjRankToRankIndex;
@@ -111,11 +155,28 @@ private:
     Direction c_direction;
     bool c_doComm;
     MPI_Win c_mpiWin;
+    bool c_useNeighborComm;
+    MPI_Comm c_neighborComm;
+    NodeBuffers *c_nodeBuffers;         // NULL if not used
+    NodeAggregator *c_nodeAggregator;   // NULL if not used
     char *c_mpiWinMemory;
     UINT c_dataSizeInBytes;
-    UINT c_maxPackets;
+    UINT c_ringSize;                    // Packets per one-sided ring
     std::vector<UINT> c_onRankOffsets;
     std::vector<UINT> c_offRankOffsets;
+    std::vector<UINT> c_numPacketsSent; // rankIndex -> packets put in ring
+    std::vector<UINT> c_numPacketsRecv; // rankIndex -> packets read from ring
+    std::vector<std::vector<char>> c_sendBacklog; // rankIndex -> packets
+    std::vector<std::vector<UINT>> c_commSides; // (rankIndex, index) -> side
+    std::vector<UINT> c_sideRankIndex;  // side -> rankIndex
+    std::vector<UINT> c_sideCommIndex;  // side -> index in c_commSides
+    std::vector<UINT> c_numSendPackets; // rankIndex -> packets per traversal
+    std::vector<UINT> c_numRecvPackets; // rankIndex -> packets per traversal
+    UINT c_nGroupBlocks;
+    UINT c_patchSize;
+    Mat2<UINT> c_patchCells;    // (index, angle) -> cell, grouped by patch
+    Mat2<UINT> c_patchBegin;    // (cell, angle) -> first index of patch
+    Mat2<UINT> c_patchEnd;      // (cell, angle) -> last index of patch + 1
 };
 
 #endif
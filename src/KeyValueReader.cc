@@ -359,6 +359,24 @@ void KeyValueReader::readFile(const string &filename)
 }
 
 
+/*
+    hasKey
+    
+    Returns true if the key is in the file.
+    Throws an error if appropriate.
+*/
+bool KeyValueReader::hasKey(const std::string &key) const
+{
+    // Check for file read
+    if (!c_data->c_isFileRead) {
+    	c_data->printMessage("File not read.");
+    	throw ExceptionFileNotRead;
+    }
+    
+    return findKey(c_data->c_keyVector, key) != KEY_NOT_FOUND;
+}
+
+
 /*
     getString
     
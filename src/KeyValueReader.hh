@@ -58,6 +58,7 @@ public:
     
     // Interface
     void readFile(const std::string &filename);
+    bool hasKey(const std::string &key) const;
     void getString(const std::string &key, std::string &value) const;
     void getInt(const std::string &key, int &value) const;
     void getDouble(const std::string &key, double &value) const;
@@ -54,11 +54,15 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "SweeperTraverse.hh"
 #include "SweeperPBJ.hh"
 #include "SweeperSchur.hh"
+#include "SweeperLevels.hh"
+#include "Autotune.hh"
 #include <signal.h>
+#include <stdlib.h>
 #include <execinfo.h>
 #include <omp.h>
 #include <unistd.h>
 #include <vector>
+#include <algorithm>
 
 
 using namespace std;
@@ -85,6 +89,30 @@ void signalHandler(int sig)
 }
 
 
+/*
+    printThreadAffinity
+    
+    Thread affinity is set with the OMP_PROC_BIND and OMP_PLACES 
+    environment variables.
+*/
+static
+void printThreadAffinity()
+{
+    const char *procBind = "false";
+    switch (omp_get_proc_bind()) {
+        case omp_proc_bind_true:    procBind = "true";   break;
+        case omp_proc_bind_master:  procBind = "master"; break;
+        case omp_proc_bind_close:   procBind = "close";  break;
+        case omp_proc_bind_spread:  procBind = "spread"; break;
+        default:                    break;
+    }
+    
+    const char *places = getenv("OMP_PLACES");
+    printf("Thread affinity: OMP_PROC_BIND=%s   OMP_PLACES=%s\n", 
+           procBind, places == NULL ? "(not set)" : places);
+}
+
+
 /*
     readInput
 */
@@ -131,6 +159,106 @@ void readInput(const string &inputFileName,
     g_ddIterMax = ddIterMax;
     
     
+    // Optional keys (default used if key is not in input deck)
+    int priorityLatencyCost = 10;
+    if (kvr.hasKey("PriorityLatencyCost"))
+        kvr.getInt("PriorityLatencyCost", priorityLatencyCost);
+    Insist(priorityLatencyCost >= 0, 
+           "PriorityLatencyCost must be nonnegative.");
+    g_priorityLatencyCost = priorityLatencyCost;
+    
+    int patchSize = 1;
+    if (kvr.hasKey("PatchSize"))
+        kvr.getInt("PatchSize", patchSize);
+    Insist(patchSize > 0, "PatchSize must be positive.");
+    g_patchSize = patchSize;
+    
+    g_adaptiveCellsPerStep = false;
+    if (kvr.hasKey("AdaptiveCellsPerStep"))
+        kvr.getBool("AdaptiveCellsPerStep", g_adaptiveCellsPerStep);
+    
+    int groupBlockSize = nGroups;
+    if (kvr.hasKey("GroupBlockSize"))
+        kvr.getInt("GroupBlockSize", groupBlockSize);
+    Insist(groupBlockSize > 0, "GroupBlockSize must be positive.");
+    groupBlockSize = min(groupBlockSize, nGroups);
+    g_nGroupBlocks = (nGroups + groupBlockSize - 1) / groupBlockSize;
+    
+    int nSources = 1;
+    if (kvr.hasKey("NumSources"))
+        kvr.getInt("NumSources", nSources);
+    Insist(nSources > 0, "NumSources must be positive.");
+    g_nSources = nSources;
+    
+    g_useCommThread = false;
+    if (kvr.hasKey("CommThread"))
+        kvr.getBool("CommThread", g_useCommThread);
+    
+    g_useSharedMemoryComm = false;
+    if (kvr.hasKey("SharedMemoryComm"))
+        kvr.getBool("SharedMemoryComm", g_useSharedMemoryComm);
+    
+    g_useSinglePrecisionComm = false;
+    if (kvr.hasKey("SinglePrecisionComm"))
+        kvr.getBool("SinglePrecisionComm", g_useSinglePrecisionComm);
+    
+    int oneSidedRingSize = 0;
+    if (kvr.hasKey("OneSidedRingSize"))
+        kvr.getInt("OneSidedRingSize", oneSidedRingSize);
+    Insist(oneSidedRingSize >= 0, "OneSidedRingSize must be nonnegative.");
+    g_oneSidedRingSize = oneSidedRingSize;
+    
+    g_coalesceMessages = false;
+    if (kvr.hasKey("CoalesceMessages"))
+        kvr.getBool("CoalesceMessages", g_coalesceMessages);
+    
+    g_useNeighborCollectives = false;
+    if (kvr.hasKey("NeighborCollectives"))
+        kvr.getBool("NeighborCollectives", g_useNeighborCollectives);
+    
+    g_useNodeAggregation = false;
+    if (kvr.hasKey("NodeAggregation"))
+        kvr.getBool("NodeAggregation", g_useNodeAggregation);
+    Insist(!g_useNodeAggregation || !g_useSharedMemoryComm, 
+           "NodeAggregation cannot be used with SharedMemoryComm.");
+    
+    int nodeAggregationRanksPerNode = 0;
+    if (kvr.hasKey("NodeAggregationRanksPerNode"))
+        kvr.getInt("NodeAggregationRanksPerNode", nodeAggregationRanksPerNode);
+    Insist(nodeAggregationRanksPerNode >= 0, 
+           "NodeAggregationRanksPerNode must be nonnegative.");
+    g_nodeAggregationRanksPerNode = nodeAggregationRanksPerNode;
+    
+    g_useDeltaComm = false;
+    if (kvr.hasKey("DeltaComm"))
+        kvr.getBool("DeltaComm", g_useDeltaComm);
+    Insist(!g_useDeltaComm || 
+           (!g_useNeighborCollectives && !g_useNodeAggregation), 
+           "DeltaComm cannot be used with NeighborCollectives or "
+           "NodeAggregation.");
+    
+    g_deltaCommFactor = 0.1;
+    if (kvr.hasKey("DeltaCommFactor"))
+        kvr.getDouble("DeltaCommFactor", g_deltaCommFactor);
+    Insist(g_deltaCommFactor >= 0.0, "DeltaCommFactor must be nonnegative.");
+    
+    g_scheduleCache = "";
+    if (kvr.hasKey("ScheduleCache"))
+        kvr.getString("ScheduleCache", g_scheduleCache);
+    
+    g_autotune = false;
+    if (kvr.hasKey("Autotune"))
+        kvr.getBool("Autotune", g_autotune);
+    
+    g_autotuneFilename = "autotune.deck";
+    if (kvr.hasKey("AutotuneFilename"))
+        kvr.getString("AutotuneFilename", g_autotuneFilename);
+    
+    g_useStarvationHints = false;
+    if (kvr.hasKey("StarvationHints"))
+        kvr.getBool("StarvationHints", g_useStarvationHints);
+    
+    
     
     string sweepType;
     kvr.getString("SweepType", sweepType);
@@ -152,8 +280,18 @@ void readInput(const string &inputFileName,
         g_sweepType = SweepType_PBJSI;
     else if (sweepType == "SchurKrylov")
         g_sweepType = SweepType_SchurKrylov;
+    else if (sweepType == "TraverseLevels")
+        g_sweepType = SweepType_TraverseLevels;
     else
         Insist(false, "Sweep type not recognized.");
+    Insist(!g_useDeltaComm || g_sweepType == SweepType_PBJ || 
+           g_sweepType == SweepType_PBJOuter || g_sweepType == SweepType_PBJSI,
+           "DeltaComm requires a PBJ sweep type.");
+    Insist(!g_autotune || g_sweepType == SweepType_TraverseGraph,
+           "Autotune requires SweepType TraverseGraph.");
+    Insist(g_intraAngleP <= 4 || 
+           (g_intraAngleP == 5 && g_sweepType == SweepType_TraverseGraph),
+           "intraAngleP must be 0-4, or 5 with SweepType TraverseGraph.");
 
 
     string gaussElimMethod;
@@ -170,6 +308,41 @@ void readInput(const string &inputFileName,
 }
 
 
+/*
+    requiredThreadLevel
+    
+    Returns the MPI thread support needed by the input deck.
+    GraphTraverser calls MPI from the master thread of a parallel region 
+    (MPI_THREAD_FUNNELED) or, with CommThread, from one comm thread 
+    (MPI_THREAD_SERIALIZED).  OriginalTycho2 calls MPI from every thread 
+    (MPI_THREAD_MULTIPLE).  MULTIPLE is only asked for when needed, since 
+    some MPI builds use slower locked paths for it.
+    
+    This is called before MPI is initialized, so it only reads the keys it
+    needs.  The deck is checked by readInput.
+*/
+static
+int requiredThreadLevel(const string &inputFileName)
+{
+    CKG_Utils::KeyValueReader kvr;
+    kvr.readFile(inputFileName);
+    
+    string sweepType;
+    if (kvr.hasKey("SweepType"))
+        kvr.getString("SweepType", sweepType);
+    if (sweepType == "OriginalTycho2")
+        return MPI_THREAD_MULTIPLE;
+    
+    bool useCommThread = false;
+    if (kvr.hasKey("CommThread"))
+        kvr.getBool("CommThread", useCommThread);
+    if (useCommThread)
+        return MPI_THREAD_SERIALIZED;
+    
+    return MPI_THREAD_FUNNELED;
+}
+
+
 /*
     main
     
@@ -185,12 +358,14 @@ int main(int argc, char *argv[])
     signal(SIGABRT, signalHandler);
     
     
-    // Init MPI
-    int required = MPI_THREAD_SINGLE;
+    // Init MPI with the thread support the input deck needs
+    int required = MPI_THREAD_FUNNELED;
+    if (argc >= 3)
+        required = requiredThreadLevel(argv[2]);
     int provided = MPI_THREAD_SINGLE;
     int mpiResult = MPI_Init_thread(&argc, &argv, required, &provided);
     Insist (mpiResult == MPI_SUCCESS, "MPI_Init failed.");
-    Insist (required <= provided, "");
+    Insist (MPI_THREAD_FUNNELED <= provided, "");
 
 
     // Startup Petsc
@@ -208,6 +383,11 @@ int main(int argc, char *argv[])
         return 0;
     }
     readInput(argv[2], sigmaT1, sigmaS1, sigmaT2, sigmaS2);
+    Insist(!g_useCommThread || MPI_THREAD_SERIALIZED <= provided, 
+           "CommThread requires MPI_THREAD_SERIALIZED.");
+    Insist(g_sweepType != SweepType_OriginalTycho2 || 
+           MPI_THREAD_MULTIPLE <= provided, 
+           "OriginalTycho2 requires MPI_THREAD_MULTIPLE.");
     
 
     // Print initial stuff
@@ -216,6 +396,8 @@ int main(int argc, char *argv[])
         printf("sigmaT1: %lf   sigmaS1: %lf\n", sigmaT1, sigmaS1);
         printf("sigmaT2: %lf   sigmaS2: %lf\n", sigmaT2, sigmaS2);
         printf("ASSERT_ON: %d\n", ASSERT_ON);
+        printf("Comm precision: %s\n", 
+               g_useSinglePrecisionComm ? "single" : "double");
     }
     
     
@@ -228,8 +410,30 @@ int main(int argc, char *argv[])
             g_nAngleGroups = omp_get_num_threads();
     }
     g_nThreads = g_nAngleGroups;
-    if (Comm::rank() == 0)
+    if (Comm::rank() == 0) {
         printf("Num angle groups: %" PRIu64 "\n", g_nAngleGroups);
+        printThreadAffinity();
+    }
+    
+    
+    // Calibrate message coalescing
+    // Flushing at latency * bandwidth bytes keeps the latency of a message 
+    // at most half its cost.  Holding a message longer than the latency 
+    // costs more than sending another message would.
+    g_coalesceBytes = 0;
+    g_coalesceDeadline = 0.0;
+    if (g_coalesceMessages) {
+        double latency, bandwidth;
+        Comm::measureLatencyBandwidth(latency, bandwidth);
+        g_coalesceBytes = latency * bandwidth;
+        g_coalesceDeadline = latency;
+        if (Comm::rank() == 0) {
+            printf("Coalesce messages: latency %e s, bandwidth %e B/s\n", 
+                   latency, bandwidth);
+            printf("Coalesce messages: flush at %" PRIu64 " bytes or %e s\n",
+                   g_coalesceBytes, g_coalesceDeadline);
+        }
+    }
             
     
     // Create quadrature
@@ -256,6 +460,12 @@ int main(int argc, char *argv[])
                                  sigmaT2, sigmaS2);
     
     
+    // Autotune sweep parameters
+    // The solve below uses the best parameters found.
+    if (g_autotune)
+        Autotune::tune(g_autotuneFilename);
+    
+    
     // Setup sweeper
     SweeperAbstract *sweeper = NULL;
     switch (g_sweepType) {
@@ -267,7 +477,8 @@ int main(int argc, char *argv[])
         case SweepType_TraverseGraph:
             g_graphTraverserForward = 
                 new GraphTraverser(Direction_Forward, true, 
-                                   SweepData::getDataSizeInBytes());
+                                   SweepData::getDataSizeInBytes(g_nGroupBlocks),
+                                   g_nGroupBlocks);
             sweeper = new SweeperTraverse();
             break;
         case SweepType_Schur:
@@ -306,6 +517,10 @@ int main(int argc, char *argv[])
                                    SweepData::getDataSizeInBytes());
             sweeper = new SweeperPBJSI();
             break;
+        case SweepType_TraverseLevels:
+            g_graphTraverserForward = NULL;
+            sweeper = new SweeperLevels();
+            break;
         default:
             Insist(false, "Sweep type not recognized.");
             break;
@@ -0,0 +1,495 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "NodeAggregator.hh"
+#include "Assert.hh"
+#include "Comm.hh"
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
+
+
+// Tags for messages between adjacent ranks and between node leaders
+static const int DIRECT_TAG = 0;
+static const int LEADER_TAG = 1;
+
+// Each entry of aggregated data is (source rank, destination rank, 
+// number of bytes) followed by the bytes
+static const UINT ENTRY_HEADER_SIZE = 3 * sizeof(UINT);
+
+
+/*
+    appendEntry
+    
+    Appends an entry to data.
+*/
+static
+void appendEntry(std::vector<char> &data, UINT srcRank, UINT dstRank, 
+                 const char *bytes, UINT numBytes)
+{
+    UINT header[3] = {srcRank, dstRank, numBytes};
+    UINT position = data.size();
+    data.resize(position + ENTRY_HEADER_SIZE + numBytes);
+    memcpy(&data[position], header, ENTRY_HEADER_SIZE);
+    if (numBytes > 0)
+        memcpy(&data[position + ENTRY_HEADER_SIZE], bytes, numBytes);
+}
+
+
+/*
+    appendEntryParts
+    
+    Appends an entry to data whose bytes are the parts in order.
+*/
+static
+void appendEntryParts(
+    std::vector<char> &data, UINT srcRank, UINT dstRank, UINT rankIndex,
+    const std::vector<const std::vector<std::vector<char>>*> &parts, 
+    UINT numBytes)
+{
+    UINT header[3] = {srcRank, dstRank, numBytes};
+    UINT position = data.size();
+    data.resize(position + ENTRY_HEADER_SIZE + numBytes);
+    memcpy(&data[position], header, ENTRY_HEADER_SIZE);
+    position += ENTRY_HEADER_SIZE;
+    for (const auto *part : parts) {
+        const std::vector<char> &bytes = (*part)[rankIndex];
+        if (bytes.size() > 0)
+            memcpy(&data[position], bytes.data(), bytes.size());
+        position += bytes.size();
+    }
+}
+
+
+/*
+    readEntry
+    
+    Reads the entry at position of data and moves position to the next one.
+*/
+static
+const char* readEntry(const char *data, UINT &position, 
+                      UINT &srcRank, UINT &dstRank, UINT &numBytes)
+{
+    UINT header[3];
+    memcpy(header, &data[position], ENTRY_HEADER_SIZE);
+    srcRank = header[0];
+    dstRank = header[1];
+    numBytes = header[2];
+    const char *bytes = &data[position + ENTRY_HEADER_SIZE];
+    position += ENTRY_HEADER_SIZE + numBytes;
+    return bytes;
+}
+
+
+/*
+    Constructor
+*/
+NodeAggregator::NodeAggregator(const std::vector<UINT> &adjRanks, 
+                               UINT ranksPerNode)
+: c_adjRanks(adjRanks)
+{
+    int mpiError;
+    UINT numAdjRanks = adjRanks.size();
+    int myRank = Comm::rank();
+    int numRanks = Comm::numRanks();
+    
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        c_adjRankToRankIndex[adjRanks[rankIndex]] = rankIndex;
+    }
+    
+    
+    // Communicators for all ranks and for this node
+    mpiError = MPI_Comm_dup(MPI_COMM_WORLD, &c_comm);
+    Insist(mpiError == MPI_SUCCESS, "");
+    
+    if (ranksPerNode > 0) {
+        mpiError = MPI_Comm_split(c_comm, myRank / ranksPerNode, myRank, 
+                                  &c_nodeComm);
+    }
+    else {
+        mpiError = MPI_Comm_split_type(c_comm, MPI_COMM_TYPE_SHARED, myRank, 
+                                       MPI_INFO_NULL, &c_nodeComm);
+    }
+    Insist(mpiError == MPI_SUCCESS, "");
+    
+    int nodeRank = Comm::rank(c_nodeComm);
+    c_isLeader = (nodeRank == 0);
+    
+    
+    // Leader and node rank of every rank
+    int leader = myRank;
+    mpiError = MPI_Bcast(&leader, 1, MPI_INT, 0, c_nodeComm);
+    Insist(mpiError == MPI_SUCCESS, "");
+    
+    int myNodeInfo[2] = {leader, nodeRank};
+    std::vector<int> nodeInfo(2 * numRanks);
+    mpiError = MPI_Allgather(myNodeInfo, 2, MPI_INT, nodeInfo.data(), 2, 
+                             MPI_INT, c_comm);
+    Insist(mpiError == MPI_SUCCESS, "");
+    
+    c_rankNode.resize(numRanks);
+    c_rankNodeRank.resize(numRanks);
+    for (int rank = 0; rank < numRanks; rank++) {
+        c_rankNode[rank] = nodeInfo[2 * rank];
+        c_rankNodeRank[rank] = nodeInfo[2 * rank + 1];
+    }
+    
+    c_onNode.resize(numAdjRanks);
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        c_onNode[rankIndex] = (c_rankNode[adjRanks[rankIndex]] == leader);
+    }
+    
+    
+    // Leaders of adjacent nodes
+    // The leader takes the union over the ranks of its node.
+    std::vector<int> adjLeaders;
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        if (!c_onNode[rankIndex])
+            adjLeaders.push_back(c_rankNode[adjRanks[rankIndex]]);
+    }
+    
+    int numAdjLeaders = adjLeaders.size();
+    int nodeSize = 0;
+    MPI_Comm_size(c_nodeComm, &nodeSize);
+    std::vector<int> counts(nodeSize);
+    mpiError = MPI_Gather(&numAdjLeaders, 1, MPI_INT, counts.data(), 1, 
+                          MPI_INT, 0, c_nodeComm);
+    Insist(mpiError == MPI_SUCCESS, "");
+    
+    std::vector<int> displs(nodeSize, 0);
+    for (int i = 1; i < nodeSize; i++) {
+        displs[i] = displs[i-1] + counts[i-1];
+    }
+    std::vector<int> nodeAdjLeaders(
+        c_isLeader ? displs[nodeSize-1] + counts[nodeSize-1] : 0);
+    mpiError = MPI_Gatherv(adjLeaders.data(), numAdjLeaders, MPI_INT, 
+                           nodeAdjLeaders.data(), counts.data(), 
+                           displs.data(), MPI_INT, 0, c_nodeComm);
+    Insist(mpiError == MPI_SUCCESS, "");
+    
+    if (c_isLeader) {
+        std::sort(nodeAdjLeaders.begin(), nodeAdjLeaders.end());
+        nodeAdjLeaders.erase(
+            std::unique(nodeAdjLeaders.begin(), nodeAdjLeaders.end()), 
+            nodeAdjLeaders.end());
+        c_adjLeaders = nodeAdjLeaders;
+    }
+}
+
+
+/*
+    Destructor
+*/
+NodeAggregator::~NodeAggregator()
+{
+    MPI_Comm_free(&c_nodeComm);
+    MPI_Comm_free(&c_comm);
+}
+
+
+/*
+    exchange
+    
+    Sends sendBuffers(rankIndex) to adjacent rank index rankIndex and puts 
+    the data from it in recvBuffers(rankIndex).  Every adjacent rank gets a
+    (possibly empty) buffer from this rank.
+*/
+void NodeAggregator::exchange(const std::vector<std::vector<char>> &sendBuffers,
+                              std::vector<std::vector<char>> &recvBuffers)
+{
+    Assert(sendBuffers.size() == c_adjRanks.size());
+    c_sendParts.assign(1, &sendBuffers);
+    exchangeParts(recvBuffers);
+}
+
+
+/*
+    exchange
+    
+    Same as above, but the data to adjacent rank index rankIndex is 
+    sendBuffers(part)(rankIndex) for each part in order.  The parts are 
+    sent in place (on node) or copied once into the aggregated data, so 
+    they need not be gathered into one buffer first.
+*/
+void NodeAggregator::exchange(
+    const std::vector<std::vector<std::vector<char>>> &sendBuffers,
+    std::vector<std::vector<char>> &recvBuffers)
+{
+    c_sendParts.clear();
+    for (const auto &part : sendBuffers) {
+        Assert(part.size() == c_adjRanks.size());
+        c_sendParts.push_back(&part);
+    }
+    exchangeParts(recvBuffers);
+}
+
+
+/*
+    sendSize
+    
+    Total number of bytes of c_sendParts to adjacent rank index rankIndex.
+*/
+UINT NodeAggregator::sendSize(UINT rankIndex) const
+{
+    UINT size = 0;
+    for (const auto *part : c_sendParts) {
+        size += (*part)[rankIndex].size();
+    }
+    return size;
+}
+
+
+/*
+    exchangeParts
+    
+    Does the exchange for the data in c_sendParts.
+    
+    The algorithm is
+    - ISend the data for adjacent ranks on this node
+    - Gather the data for other nodes on the leader
+    - The leader sends one message to each adjacent node's leader, 
+      receives one from each, and scatters the data to the ranks of its node
+    - Recv the data from adjacent ranks on this node
+*/
+void NodeAggregator::exchangeParts(std::vector<std::vector<char>> &recvBuffers)
+{
+    int mpiError;
+    UINT numAdjRanks = c_adjRanks.size();
+    UINT myRank = Comm::rank();
+    
+    recvBuffers.resize(numAdjRanks);
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        recvBuffers[rankIndex].clear();
+    }
+    
+    
+    // Send data to adjacent ranks on this node
+    // The parts are sent in place as one message using an hindexed 
+    // datatype over their addresses.
+    std::vector<MPI_Request> directRequests;
+    std::vector<int> blockLengths;
+    std::vector<MPI_Aint> displacements;
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        if (!c_onNode[rankIndex])
+            continue;
+        
+        blockLengths.clear();
+        displacements.clear();
+        for (const auto *part : c_sendParts) {
+            const std::vector<char> &sendBuffer = (*part)[rankIndex];
+            if (sendBuffer.size() == 0)
+                continue;
+            Assert(sendBuffer.size() < INT_MAX);
+            MPI_Aint address;
+            mpiError = MPI_Get_address(sendBuffer.data(), &address);
+            Insist(mpiError == MPI_SUCCESS, "");
+            blockLengths.push_back(sendBuffer.size());
+            displacements.push_back(address);
+        }
+        
+        MPI_Datatype sendType;
+        mpiError = MPI_Type_create_hindexed(blockLengths.size(), 
+                                            blockLengths.data(), 
+                                            displacements.data(), 
+                                            MPI_BYTE, &sendType);
+        Insist(mpiError == MPI_SUCCESS, "");
+        mpiError = MPI_Type_commit(&sendType);
+        Insist(mpiError == MPI_SUCCESS, "");
+        
+        MPI_Request request;
+        mpiError = MPI_Isend(MPI_BOTTOM, 1, sendType, c_adjRanks[rankIndex], 
+                             DIRECT_TAG, c_comm, &request);
+        Insist(mpiError == MPI_SUCCESS, "");
+        directRequests.push_back(request);
+        
+        mpiError = MPI_Type_free(&sendType);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+    
+    
+    // Gather data for other nodes on the leader
+    c_sendData.clear();
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        UINT numBytes = sendSize(rankIndex);
+        if (!c_onNode[rankIndex] && numBytes > 0) {
+            appendEntryParts(c_sendData, myRank, c_adjRanks[rankIndex], 
+                             rankIndex, c_sendParts, numBytes);
+        }
+    }
+    
+    int nodeSize = 0;
+    MPI_Comm_size(c_nodeComm, &nodeSize);
+    std::vector<int> counts(nodeSize);
+    std::vector<int> displs(nodeSize, 0);
+    Assert(c_sendData.size() < INT_MAX);
+    int sendSize = c_sendData.size();
+    mpiError = MPI_Gather(&sendSize, 1, MPI_INT, counts.data(), 1, MPI_INT, 
+                          0, c_nodeComm);
+    Insist(mpiError == MPI_SUCCESS, "");
+    
+    std::vector<char> nodeData;
+    if (c_isLeader) {
+        UINT totalSize = 0;
+        for (int i = 0; i < nodeSize; i++) {
+            Assert(totalSize < INT_MAX);
+            displs[i] = totalSize;
+            totalSize += counts[i];
+        }
+        nodeData.resize(totalSize);
+    }
+    mpiError = MPI_Gatherv(c_sendData.data(), sendSize, MPI_BYTE, 
+                           nodeData.data(), counts.data(), displs.data(), 
+                           MPI_BYTE, 0, c_nodeComm);
+    Insist(mpiError == MPI_SUCCESS, "");
+    
+    
+    // Leader exchanges data with adjacent nodes
+    // Received data is sorted by destination rank in this node.
+    std::vector<std::vector<char>> memberData;
+    if (c_isLeader) {
+        UINT numAdjLeaders = c_adjLeaders.size();
+        std::vector<std::vector<char>> leaderData(numAdjLeaders);
+        UINT position = 0;
+        while (position < nodeData.size()) {
+            UINT srcRank, dstRank, numBytes;
+            const char *bytes = readEntry(nodeData.data(), position, 
+                                          srcRank, dstRank, numBytes);
+            UINT leaderIndex = 
+                std::lower_bound(c_adjLeaders.begin(), c_adjLeaders.end(), 
+                                 c_rankNode[dstRank]) - c_adjLeaders.begin();
+            Assert(leaderIndex < numAdjLeaders);
+            appendEntry(leaderData[leaderIndex], srcRank, dstRank, bytes, 
+                        numBytes);
+        }
+        
+        std::vector<MPI_Request> leaderRequests(numAdjLeaders);
+        for (UINT i = 0; i < numAdjLeaders; i++) {
+            Assert(leaderData[i].size() < INT_MAX);
+            mpiError = MPI_Isend(leaderData[i].data(), leaderData[i].size(), 
+                                 MPI_BYTE, c_adjLeaders[i], LEADER_TAG, 
+                                 c_comm, &leaderRequests[i]);
+            Insist(mpiError == MPI_SUCCESS, "");
+        }
+        
+        memberData.resize(nodeSize);
+        std::vector<char> &recvData = c_recvData;
+        for (UINT i = 0; i < numAdjLeaders; i++) {
+            MPI_Status status;
+            int recvSize;
+            mpiError = MPI_Probe(c_adjLeaders[i], LEADER_TAG, c_comm, &status);
+            Insist(mpiError == MPI_SUCCESS, "");
+            MPI_Get_count(&status, MPI_BYTE, &recvSize);
+            recvData.resize(recvSize);
+            mpiError = MPI_Recv(recvData.data(), recvSize, MPI_BYTE, 
+                                c_adjLeaders[i], LEADER_TAG, c_comm, 
+                                MPI_STATUS_IGNORE);
+            Insist(mpiError == MPI_SUCCESS, "");
+            
+            position = 0;
+            while (position < recvData.size()) {
+                UINT srcRank, dstRank, numBytes;
+                const char *bytes = readEntry(recvData.data(), position, 
+                                              srcRank, dstRank, numBytes);
+                appendEntry(memberData[c_rankNodeRank[dstRank]], 
+                            srcRank, dstRank, bytes, numBytes);
+            }
+        }
+        
+        if (numAdjLeaders > 0) {
+            mpiError = MPI_Waitall(numAdjLeaders, leaderRequests.data(), 
+                                   MPI_STATUSES_IGNORE);
+            Insist(mpiError == MPI_SUCCESS, "");
+        }
+        
+        nodeData.clear();
+        for (int i = 0; i < nodeSize; i++) {
+            Assert(nodeData.size() < INT_MAX);
+            counts[i] = memberData[i].size();
+            displs[i] = nodeData.size();
+            nodeData.insert(nodeData.end(), memberData[i].begin(), 
+                            memberData[i].end());
+        }
+    }
+    
+    
+    // Scatter data from other nodes
+    int recvSize = 0;
+    mpiError = MPI_Scatter(counts.data(), 1, MPI_INT, &recvSize, 1, MPI_INT, 
+                           0, c_nodeComm);
+    Insist(mpiError == MPI_SUCCESS, "");
+    c_recvData.resize(recvSize);
+    mpiError = MPI_Scatterv(nodeData.data(), counts.data(), displs.data(), 
+                            MPI_BYTE, c_recvData.data(), recvSize, MPI_BYTE, 
+                            0, c_nodeComm);
+    Insist(mpiError == MPI_SUCCESS, "");
+    
+    UINT position = 0;
+    while (position < c_recvData.size()) {
+        UINT srcRank, dstRank, numBytes;
+        const char *bytes = readEntry(c_recvData.data(), position, 
+                                      srcRank, dstRank, numBytes);
+        Assert(dstRank == myRank);
+        UINT rankIndex = c_adjRankToRankIndex.at(srcRank);
+        recvBuffers[rankIndex].assign(bytes, bytes + numBytes);
+    }
+    
+    
+    // Recv data from adjacent ranks on this node
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        if (!c_onNode[rankIndex])
+            continue;
+        
+        MPI_Status status;
+        int size;
+        int adjRank = c_adjRanks[rankIndex];
+        mpiError = MPI_Probe(adjRank, DIRECT_TAG, c_comm, &status);
+        Insist(mpiError == MPI_SUCCESS, "");
+        MPI_Get_count(&status, MPI_BYTE, &size);
+        recvBuffers[rankIndex].resize(size);
+        mpiError = MPI_Recv(recvBuffers[rankIndex].data(), size, MPI_BYTE, 
+                            adjRank, DIRECT_TAG, c_comm, MPI_STATUS_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+    
+    if (directRequests.size() > 0) {
+        mpiError = MPI_Waitall(directRequests.size(), directRequests.data(), 
+                               MPI_STATUSES_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+}
@@ -0,0 +1,105 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __NODE_AGGREGATOR_HH__
+#define __NODE_AGGREGATOR_HH__
+
+#include "Global.hh"
+#include <mpi.h>
+#include <vector>
+#include <map>
+
+
+/*
+    NodeAggregator
+    
+    Two-level exchange of data with adjacent ranks.
+    Data for adjacent ranks on the same node is sent directly.  Data for 
+    adjacent ranks on other nodes is gathered by the node leader (rank 0 of
+    the node), sent as one message to the leader of each adjacent node, and
+    scattered there to the receiving ranks.  So the number of inter-node 
+    messages per exchange is the number of adjacent node pairs, not of 
+    adjacent rank pairs.
+    
+    A node is the ranks sharing memory (MPI_COMM_TYPE_SHARED) or, if 
+    ranksPerNode > 0, each block of ranksPerNode consecutive ranks.
+    
+    Creation and exchange are collective over MPI_COMM_WORLD.  Adjacency 
+    must be symmetric.
+*/
+class NodeAggregator
+{
+public:
+    NodeAggregator(const std::vector<UINT> &adjRanks, UINT ranksPerNode);
+    ~NodeAggregator();
+    
+    // Don't allow copy constructor or assignment operator
+    NodeAggregator(const NodeAggregator &other) = delete;
+    NodeAggregator & operator= (const NodeAggregator &other) = delete;
+    
+    void exchange(const std::vector<std::vector<char>> &sendBuffers,
+                  std::vector<std::vector<char>> &recvBuffers);
+    void exchange(
+        const std::vector<std::vector<std::vector<char>>> &sendBuffers,
+        std::vector<std::vector<char>> &recvBuffers);
+
+private:
+    void exchangeParts(std::vector<std::vector<char>> &recvBuffers);
+    UINT sendSize(UINT rankIndex) const;
+    
+
+    MPI_Comm c_comm;                    // Duplicate of MPI_COMM_WORLD
+    MPI_Comm c_nodeComm;
+    bool c_isLeader;
+    std::vector<UINT> c_adjRanks;
+    std::map<UINT,UINT> c_adjRankToRankIndex;
+    std::vector<bool> c_onNode;         // rankIndex -> on this node
+    std::vector<int> c_rankNode;        // rank -> leader of its node
+    std::vector<int> c_rankNodeRank;    // rank -> rank in its node
+    std::vector<int> c_adjLeaders;      // Leaders of adjacent nodes
+    
+    // Temporary storage for exchange
+    // The data to adjacent rank index is (*c_sendParts[part])[rankIndex] 
+    // for each part in order.
+    std::vector<const std::vector<std::vector<char>>*> c_sendParts;
+    std::vector<char> c_sendData;
+    std::vector<char> c_recvData;
+};
+
+#endif
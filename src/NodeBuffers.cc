@@ -0,0 +1,250 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "NodeBuffers.hh"
+#include "Assert.hh"
+#include "Comm.hh"
+#include <string.h>
+
+
+// Offsets of the counters and buffer in a slot
+static const UINT NUM_WRITTEN_OFFSET = 0;
+static const UINT NUM_READ_OFFSET = 8;
+static const UINT BUFFER_OFFSET = 16;
+
+
+/*
+    Constructor
+    
+    recvSizes(rankIndex) is the size in bytes of the recv buffer for 
+    adjacent rank adjRanks(rankIndex).  It is only used if that rank is on 
+    this node.
+*/
+NodeBuffers::NodeBuffers(const std::vector<UINT> &adjRanks, 
+                         const std::vector<UINT> &recvSizes)
+{
+    int mpiError;
+    UINT numAdjRanks = adjRanks.size();
+    Assert(recvSizes.size() == numAdjRanks);
+    
+    
+    // Find the adjacent ranks on this node
+    mpiError = MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, 
+                                   MPI_INFO_NULL, &c_nodeComm);
+    Insist(mpiError == MPI_SUCCESS, "");
+    c_nodeRank = Comm::rank(c_nodeComm);
+    
+    MPI_Group worldGroup, nodeGroup;
+    MPI_Comm_group(MPI_COMM_WORLD, &worldGroup);
+    MPI_Comm_group(c_nodeComm, &nodeGroup);
+    std::vector<int> worldRanks(adjRanks.begin(), adjRanks.end());
+    c_adjNodeRanks.resize(numAdjRanks);
+    if (numAdjRanks > 0) {
+        mpiError = MPI_Group_translate_ranks(worldGroup, numAdjRanks, 
+                                             worldRanks.data(), nodeGroup, 
+                                             c_adjNodeRanks.data());
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+    MPI_Group_free(&worldGroup);
+    MPI_Group_free(&nodeGroup);
+    
+    c_onNode.resize(numAdjRanks);
+    for (UINT i = 0; i < numAdjRanks; i++) {
+        c_onNode[i] = (c_adjNodeRanks[i] != MPI_UNDEFINED);
+    }
+    
+    
+    // Allocate a slot for each adjacent rank on the node
+    UINT windowSizeInBytes = 0;
+    c_recvOffsets.assign(numAdjRanks, 0);
+    for (UINT i = 0; i < numAdjRanks; i++) {
+        if (c_onNode[i]) {
+            c_recvOffsets[i] = windowSizeInBytes;
+            windowSizeInBytes += BUFFER_OFFSET + recvSizes[i];
+        }
+    }
+    
+    char *memory;
+    MPI_Info mpiInfo;
+    MPI_Info_create(&mpiInfo);
+    MPI_Info_set(mpiInfo, "alloc_shared_noncontig", "true");
+    mpiError = MPI_Win_allocate_shared(windowSizeInBytes, 1, mpiInfo, 
+                                       c_nodeComm, &memory, &c_mpiWin);
+    Insist(mpiError == MPI_SUCCESS, "");
+    MPI_Info_free(&mpiInfo);
+    
+    
+    // Exchange slot offsets with the adjacent ranks on the node
+    c_sendOffsets.assign(numAdjRanks, 0);
+    std::vector<MPI_Request> mpiRequests;
+    for (UINT i = 0; i < numAdjRanks; i++) {
+        if (!c_onNode[i])
+            continue;
+        
+        int tag = 0;
+        MPI_Request request;
+        mpiError = MPI_Isend(&c_recvOffsets[i], 1, MPI_UINT64_T, adjRanks[i], 
+                             tag, MPI_COMM_WORLD, &request);
+        Insist(mpiError == MPI_SUCCESS, "");
+        mpiRequests.push_back(request);
+        
+        mpiError = MPI_Irecv(&c_sendOffsets[i], 1, MPI_UINT64_T, adjRanks[i], 
+                             tag, MPI_COMM_WORLD, &request);
+        Insist(mpiError == MPI_SUCCESS, "");
+        mpiRequests.push_back(request);
+    }
+    if (mpiRequests.size() > 0) {
+        mpiError = MPI_Waitall(mpiRequests.size(), mpiRequests.data(), 
+                               MPI_STATUSES_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+    
+    
+    // Addresses of the buffers
+    c_recvBuffers.assign(numAdjRanks, NULL);
+    c_sendBuffers.assign(numAdjRanks, NULL);
+    for (UINT i = 0; i < numAdjRanks; i++) {
+        if (!c_onNode[i])
+            continue;
+        
+        MPI_Aint size;
+        int dispUnit;
+        char *adjMemory;
+        mpiError = MPI_Win_shared_query(c_mpiWin, c_adjNodeRanks[i], &size, 
+                                        &dispUnit, &adjMemory);
+        Insist(mpiError == MPI_SUCCESS, "");
+        
+        c_recvBuffers[i] = memory + c_recvOffsets[i] + BUFFER_OFFSET;
+        c_sendBuffers[i] = adjMemory + c_sendOffsets[i] + BUFFER_OFFSET;
+    }
+    
+    
+    // Lock the window to start RMA operations and set memory to zero
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, c_mpiWin);
+    memset(memory, 0, windowSizeInBytes);
+    MPI_Win_sync(c_mpiWin);
+    MPI_Barrier(c_nodeComm);
+}
+
+
+/*
+    Destructor
+*/
+NodeBuffers::~NodeBuffers()
+{
+    MPI_Win_unlock_all(c_mpiWin);
+    MPI_Win_free(&c_mpiWin);
+    MPI_Comm_free(&c_nodeComm);
+}
+
+
+/*
+    getCount
+    
+    Atomically reads a counter in this rank's memory.
+    The sync makes the data written before the counter was set visible.
+*/
+UINT NodeBuffers::getCount(UINT offset)
+{
+    int mpiError;
+    UINT dummy = 0;
+    UINT count;
+    
+    mpiError = MPI_Fetch_and_op(&dummy, &count, MPI_UINT64_T, c_nodeRank, 
+                                offset, MPI_NO_OP, c_mpiWin);
+    Insist(mpiError == MPI_SUCCESS, "");
+    mpiError = MPI_Win_flush_local(c_nodeRank, c_mpiWin);
+    Insist(mpiError == MPI_SUCCESS, "");
+    MPI_Win_sync(c_mpiWin);
+    
+    return count;
+}
+
+
+/*
+    putCount
+    
+    Atomically sets a counter in the memory of a rank on the node.
+    The sync makes the data written before it visible first.
+*/
+void NodeBuffers::putCount(int nodeRank, UINT offset, UINT count)
+{
+    int mpiError;
+    
+    MPI_Win_sync(c_mpiWin);
+    mpiError = MPI_Accumulate(&count, 1, MPI_UINT64_T, nodeRank, offset, 
+                              1, MPI_UINT64_T, MPI_REPLACE, c_mpiWin);
+    Insist(mpiError == MPI_SUCCESS, "");
+    mpiError = MPI_Win_flush(nodeRank, c_mpiWin);
+    Insist(mpiError == MPI_SUCCESS, "");
+}
+
+
+/*
+    Counters
+*/
+UINT NodeBuffers::getNumWritten(UINT rankIndex)
+{
+    Assert(c_onNode[rankIndex]);
+    return getCount(c_recvOffsets[rankIndex] + NUM_WRITTEN_OFFSET);
+}
+
+UINT NodeBuffers::getNumRead(UINT rankIndex)
+{
+    Assert(c_onNode[rankIndex]);
+    return getCount(c_recvOffsets[rankIndex] + NUM_READ_OFFSET);
+}
+
+void NodeBuffers::resetNumWritten(UINT rankIndex)
+{
+    Assert(c_onNode[rankIndex]);
+    putCount(c_nodeRank, c_recvOffsets[rankIndex] + NUM_WRITTEN_OFFSET, 0);
+}
+
+void NodeBuffers::putNumWritten(UINT rankIndex, UINT count)
+{
+    Assert(c_onNode[rankIndex]);
+    putCount(c_adjNodeRanks[rankIndex], 
+             c_sendOffsets[rankIndex] + NUM_WRITTEN_OFFSET, count);
+}
+
+void NodeBuffers::putNumRead(UINT rankIndex, UINT count)
+{
+    Assert(c_onNode[rankIndex]);
+    putCount(c_adjNodeRanks[rankIndex], 
+             c_sendOffsets[rankIndex] + NUM_READ_OFFSET, count);
+}
@@ -0,0 +1,104 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __NODE_BUFFERS_HH__
+#define __NODE_BUFFERS_HH__
+
+#include "Global.hh"
+#include <mpi.h>
+#include <vector>
+
+
+/*
+    NodeBuffers
+    
+    Receive buffers in node shared memory for the adjacent ranks on the same
+    node (MPI_Comm_split_type with MPI_COMM_TYPE_SHARED).  An adjacent rank 
+    writes its data directly into this rank's buffer and then sets a counter,
+    so no MPI message or packet copy is needed.
+    
+    This rank's memory has a slot for each adjacent rank on the node with
+    (number written, number read, recv buffer).
+    Number written is set by the adjacent rank after writing to the recv 
+    buffer.  Number read is set by the adjacent rank after reading what 
+    this rank wrote to it, so it tells when the send buffer can be reused.
+    The meaning of the counts is up to the user.
+    
+    Creation is collective over MPI_COMM_WORLD.
+*/
+class NodeBuffers
+{
+public:
+    NodeBuffers(const std::vector<UINT> &adjRanks, 
+                const std::vector<UINT> &recvSizes);
+    ~NodeBuffers();
+    
+    // Don't allow copy constructor or assignment operator
+    NodeBuffers(const NodeBuffers &other) = delete;
+    NodeBuffers & operator= (const NodeBuffers &other) = delete;
+    
+    bool onNode(UINT rankIndex) const { return c_onNode[rankIndex]; }
+    
+    // Buffer in the adjacent rank's memory and this rank's memory
+    char* sendBuffer(UINT rankIndex) { return c_sendBuffers[rankIndex]; }
+    char* recvBuffer(UINT rankIndex) { return c_recvBuffers[rankIndex]; }
+    
+    // Counters in this rank's memory
+    UINT getNumWritten(UINT rankIndex);
+    UINT getNumRead(UINT rankIndex);
+    void resetNumWritten(UINT rankIndex);
+    
+    // Counters in the adjacent rank's memory
+    void putNumWritten(UINT rankIndex, UINT count);
+    void putNumRead(UINT rankIndex, UINT count);
+
+private:
+    UINT getCount(UINT offset);
+    void putCount(int nodeRank, UINT offset, UINT count);
+    
+    MPI_Comm c_nodeComm;
+    MPI_Win c_mpiWin;
+    int c_nodeRank;
+    std::vector<bool> c_onNode;
+    std::vector<int> c_adjNodeRanks;    // rankIndex -> rank in c_nodeComm
+    std::vector<UINT> c_recvOffsets;    // rankIndex -> slot in this rank
+    std::vector<UINT> c_sendOffsets;    // rankIndex -> slot in adjacent rank
+    std::vector<char*> c_recvBuffers;
+    std::vector<char*> c_sendBuffers;
+};
+
+#endif
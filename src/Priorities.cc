@@ -38,243 +38,19 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "Priorities.hh"
+#include "PriorityData.hh"
 #include "GraphTraverser.hh"
 #include "Mat.hh"
 #include "Global.hh"
 #include "TychoMesh.hh"
 #include "Comm.hh"
+#include "ScheduleCache.hh"
 #include <vector>
 #include <algorithm>
 
 using namespace std;
 
 
-/*
-    BLevelData
-    
-    Calculates b-levels when traversing a graph.
-    Note: OpenMP assumes threading across angle.
-          Without this assumption, there could be a race condition.
-*/
-class BLevelData : public TraverseData
-{
-public:
-    
-    /*
-        Constructor
-    */
-    BLevelData(Mat2<UINT> &bLevels, Mat2<UINT> &sideBLevels)
-    : c_bLevels(bLevels), c_sideBLevels(sideBLevels)
-    {
-        // Initialize all to 0 b-level
-        c_maxBLevel = 0;
-        bLevels.setAll(0);
-        sideBLevels.setAll(0);
-        c_bLevels.setAll(0);
-        c_sideBLevels.setAll(0);
-    }
-    
-    
-    /*
-        getData
-        
-        Return b-level data given (cell, angle) pair.
-    */
-    virtual const char* getData(UINT cell, UINT face, UINT angle)
-    {
-        UNUSED_VARIABLE(face);
-        return (char*) (&c_bLevels(cell, angle));
-    }
-    
-    
-    /*
-        setSideData
-        
-        Return b-level data given (side, angle) pair.
-    */
-    virtual void setSideData(UINT side, UINT angle, const char *data)
-    {
-        c_sideBLevels(side, angle) = *((UINT*)(data));
-    }
-    
-    
-    /*
-        getPriority
-        
-        Return a priority for the cell/angle pair.
-        Not needed for this class, so it is just set to a constant.
-    */
-    virtual UINT getPriority(UINT cell, UINT angle)
-    {
-        UNUSED_VARIABLE(cell);
-        UNUSED_VARIABLE(angle);
-        return 1;
-    }
-    
-    
-    /*
-        update
-        
-        Updates b-level information for a given (cell, angle) pair.
-    */
-    virtual void update(UINT cell, UINT angle, 
-                        UINT adjCellsSides[g_nFacePerCell], 
-                        BoundaryType bdryType[g_nFacePerCell])
-    {
-        c_bLevels(cell, angle) = 0;
-        for (UINT face = 0; face < g_nFacePerCell; face++) {
-            
-            if (bdryType[face] == BoundaryType_OutIntBdry) {
-                UINT adjSide = adjCellsSides[face];
-                UINT adjBLevel = c_sideBLevels(adjSide, angle);
-                c_bLevels(cell, angle) = max(c_bLevels(cell, angle), adjBLevel + 1);
-            }
-            
-            else if (bdryType[face] == BoundaryType_OutInt) {
-                UINT adjCell = adjCellsSides[face];
-                UINT adjBLevel = c_bLevels(adjCell, angle);
-                c_bLevels(cell, angle) = max(c_bLevels(cell, angle), adjBLevel + 1);
-            }
-        }
-        
-        #pragma omp critical
-        {
-            c_maxBLevel = max(c_maxBLevel, c_bLevels(cell, angle));
-        }
-    }
-    
-    
-    /*
-        getMaxBLevel
-    */
-    virtual UINT getMaxBLevel()
-    {
-        UINT maxBLevel;
-        
-        #pragma omp atomic read
-        maxBLevel = c_maxBLevel;
-        
-        return maxBLevel;
-    }
-    
-private:
-    Mat2<UINT> &c_bLevels;
-    Mat2<UINT> &c_sideBLevels;
-    UINT c_maxBLevel;
-};
-
-
-/*
-    NeighborPriorityData
-    
-    Calculates priorities when traversing a graph.
-    Can calculate BFDS, DFDS, or DFHDS depending on 
-    boundScale, boundShift, parentShift.
-    
-            boundScale   boundShift   parentShift
-    BFDS  =     1             0             0
-    DFDS  =     1         maxBLevel        -1
-    DFHDS =  maxBLevel    maxBLevel        -1
-    
-    Note: OpenMP assumes threading across angle.
-          Without this assumption, there could be a race condition.
-*/
-class NeighborPriorityData : public TraverseData
-{
-public:
-    
-    /*
-        Constructor
-    */
-    NeighborPriorityData(Mat2<UINT> &priorities, const Mat2<UINT> &sideBLevels, 
-                         const UINT boundScale, const UINT boundShift, 
-                         const int parentShift)
-    : c_priorities(priorities), c_sideBLevels(sideBLevels), 
-      c_boundScale(boundScale), c_boundShift(boundShift), c_parentShift(parentShift)
-    {
-        c_priorities.setAll(0);
-    }
-    
-    
-    /*
-        data
-        
-        Return priority data given (cell, angle) pair.
-    */
-    virtual const char* getData(UINT cell, UINT face, UINT angle)
-    {
-        UNUSED_VARIABLE(face);
-        return (char*) (&c_priorities(cell, angle));
-    }
-    
-    
-    /*
-        getPriority
-        
-        Return a priority for the cell/angle pair.
-        Not needed for this class, so it is just set to a constant.
-    */
-    virtual UINT getPriority(UINT cell, UINT angle)
-    {
-        UNUSED_VARIABLE(cell);
-        UNUSED_VARIABLE(angle);
-        return 1;
-    }
-    
-    
-    /*
-        update
-        
-        Updates priority information for a given (cell, angle) pair.
-    */
-    virtual void update(UINT cell, UINT angle, 
-                        UINT adjCellsSides[g_nFacePerCell], 
-                        BoundaryType bdryType[g_nFacePerCell])
-    {
-        c_priorities(cell, angle) = 0;
-        
-        for (UINT face = 0; face < g_nFacePerCell; face++) {
-            
-            UINT priority = 0;
-            
-            if (bdryType[face] == BoundaryType_OutIntBdry) {
-                UINT adjSide = adjCellsSides[face];
-                priority = c_sideBLevels(adjSide, angle) * c_boundScale + 
-                           c_boundShift;
-            }
-            
-            else if (bdryType[face] == BoundaryType_OutInt) {
-                UINT adjCell = adjCellsSides[face];
-                priority = c_priorities(adjCell, angle) + c_parentShift;
-            }
-            
-            c_priorities(cell, angle) = max(c_priorities(cell, angle), priority);
-        }
-    }
-    
-    
-    /*
-        These should never be called.
-        They are only used when communication is involved in traversing the
-        graph.
-    */
-    virtual void setSideData(UINT side, UINT angle, const char *data)
-    {
-        UNUSED_VARIABLE(side);
-        UNUSED_VARIABLE(angle);
-        UNUSED_VARIABLE(data);
-        Assert(false);
-    }
-    
-private:
-    Mat2<UINT> &c_priorities;
-    const Mat2<UINT> &c_sideBLevels;
-    const UINT c_boundScale;
-    const UINT c_boundShift;
-    const int c_parentShift;
-};
-
-
 /*
     calcBLevels
 */
@@ -336,6 +112,37 @@ void neighborPriorities(const Mat2<UINT> &sideBLevels,
 }
 
 
+/*
+    remotePriorities
+    
+    Communication-cost-aware priorities (see RemotePriorityData).
+    The remote b-levels come from a traversal with communication.
+    Returns the max priority + 1 over all ranks.
+*/
+static
+UINT remotePriorities(const Mat2<UINT> &bLevels, const UINT latencyCost,
+                      Mat2<UINT> &priorities, GraphTraverser *graphTraverser)
+{
+    const bool doComm = true;
+    GraphTraverser commGraphTraverser(Direction_Backward, doComm, 
+                                      sizeof(UINT));
+    Mat2<UINT> globalBLevels(g_nCells, g_nAngles);
+    Mat2<UINT> remoteSideBLevels(g_tychoMesh->getNSides(), g_nAngles);
+    calcBLevels(globalBLevels, remoteSideBLevels, &commGraphTraverser);
+    
+    RemotePriorityData priorityData(priorities, bLevels, remoteSideBLevels, 
+                                    latencyCost);
+    graphTraverser->traverse(g_maxCellsPerStep, priorityData);
+    
+    UINT maxPriority = 0;
+    for (UINT i = 0; i < priorities.size(); i++) {
+        maxPriority = max(maxPriority, priorities[i]);
+    }
+    Comm::gmax(maxPriority);
+    return maxPriority + 1;
+}
+
+
 /*
     anglePriorities
 */
@@ -392,9 +199,27 @@ namespace Priorities
 
 /*
     calcPriorities
+    
+    Reads the priorities from the schedule cache if they are there.
+    Otherwise calculates them and writes them to the cache.
 */
 void calcPriorities(Mat2<UINT> &priorities)
 {
+    vector<UINT> cacheData;
+    UINT cacheKey = ScheduleCache::getKey(
+        {g_intraAngleP, g_interAngleP, g_priorityLatencyCost});
+    if (ScheduleCache::read("priorities", cacheKey, cacheData)) {
+        Insist(cacheData.size() == priorities.size(), 
+               "Schedule cache has wrong size.");
+        for (UINT i = 0; i < priorities.size(); i++) {
+            priorities[i] = cacheData[i];
+        }
+        if (Comm::rank() == 0)
+            printf("Priorities read from schedule cache\n");
+        return;
+    }
+    
+    
     const bool doComm = false;
     GraphTraverser graphTraverser(Direction_Backward, doComm, sizeof(UINT));
     
@@ -404,6 +229,7 @@ void calcPriorities(Mat2<UINT> &priorities)
     
     UINT maxBLevel = calcBLevels(bLevels, sideBLevels, 
                                  &graphTraverser);
+    UINT nlevels = maxBLevel;
     
     
     // Calculate intra-angle priorities
@@ -427,11 +253,40 @@ void calcPriorities(Mat2<UINT> &priorities)
         neighborPriorities(sideBLevels, maxBLevel, maxBLevel, -1, 
                            priorities, &graphTraverser);
         break;
+      case 5:  // communication-cost-aware
+        nlevels = remotePriorities(bLevels, g_priorityLatencyCost, 
+                                   priorities, &graphTraverser);
+        break;
     }
     
     
     // Calculate inter-angle priorities
-    anglePriorities(numAngles, g_interAngleP, maxBLevel, priorities);
+    anglePriorities(numAngles, g_interAngleP, nlevels, priorities);
+    
+    
+    // Cache priorities
+    cacheData.resize(priorities.size());
+    for (UINT i = 0; i < priorities.size(); i++) {
+        cacheData[i] = priorities[i];
+    }
+    ScheduleCache::write("priorities", cacheKey, cacheData);
+}
+
+
+/*
+    calcGlobalBLevels
+    
+    Calculates b-levels for the whole mesh including the dependencies
+    across partition boundaries.
+    Returns the max b-level over all ranks.
+*/
+UINT calcGlobalBLevels(Mat2<UINT> &bLevels)
+{
+    const bool doComm = true;
+    GraphTraverser graphTraverser(Direction_Backward, doComm, sizeof(UINT));
+    Mat2<UINT> sideBLevels(g_tychoMesh->getNSides(), g_nAngles);
+    
+    return calcBLevels(bLevels, sideBLevels, &graphTraverser);
 }
 
 } // End namespace
@@ -47,6 +47,7 @@ namespace Priorities
 {
 
 void calcPriorities(Mat2<UINT> &priorities);
+UINT calcGlobalBLevels(Mat2<UINT> &bLevels);
 
 }
 
@@ -0,0 +1,414 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __PRIORITY_DATA_HH__
+#define __PRIORITY_DATA_HH__
+
+#include "GraphTraverser.hh"
+#include "Mat.hh"
+#include "Global.hh"
+#include "Assert.hh"
+#include "TychoMesh.hh"
+#include <algorithm>
+#include <vector>
+
+
+/*
+    BLevelData
+    
+    Calculates b-levels when traversing a graph.
+    Note: OpenMP assumes threading across angle.
+          Without this assumption, there could be a race condition.
+*/
+class BLevelData final : public TraverseData
+{
+public:
+    
+    /*
+        Constructor
+    */
+    BLevelData(Mat2<UINT> &bLevels, Mat2<UINT> &sideBLevels)
+    : c_bLevels(bLevels), c_sideBLevels(sideBLevels)
+    {
+        // Initialize all to 0 b-level
+        c_maxBLevel = 0;
+        bLevels.setAll(0);
+        sideBLevels.setAll(0);
+        c_bLevels.setAll(0);
+        c_sideBLevels.setAll(0);
+    }
+    
+    
+    /*
+        getData
+        
+        Return b-level data given (cell, angle) pair.
+    */
+    virtual const char* getData(UINT cell, UINT face, UINT angle)
+    {
+        UNUSED_VARIABLE(face);
+        return (char*) (&c_bLevels(cell, angle));
+    }
+    
+    
+    /*
+        setSideData
+        
+        Return b-level data given (side, angle) pair.
+    */
+    virtual void setSideData(UINT side, UINT angle, const char *data)
+    {
+        c_sideBLevels(side, angle) = *((UINT*)(data));
+    }
+    
+    
+    /*
+        getPriority
+        
+        Return a priority for the cell/angle pair.
+        Not needed for this class, so it is just set to a constant.
+    */
+    virtual UINT getPriority(UINT cell, UINT angle)
+    {
+        UNUSED_VARIABLE(cell);
+        UNUSED_VARIABLE(angle);
+        return 1;
+    }
+    
+    
+    /*
+        update
+        
+        Updates b-level information for a given (cell, angle) pair.
+    */
+    virtual void update(UINT cell, UINT angle, 
+                        UINT adjCellsSides[g_nFacePerCell], 
+                        BoundaryType bdryType[g_nFacePerCell])
+    {
+        c_bLevels(cell, angle) = 0;
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            
+            if (bdryType[face] == BoundaryType_OutIntBdry) {
+                UINT adjSide = adjCellsSides[face];
+                UINT adjBLevel = c_sideBLevels(adjSide, angle);
+                c_bLevels(cell, angle) = std::max(c_bLevels(cell, angle), adjBLevel + 1);
+            }
+            
+            else if (bdryType[face] == BoundaryType_OutInt) {
+                UINT adjCell = adjCellsSides[face];
+                UINT adjBLevel = c_bLevels(adjCell, angle);
+                c_bLevels(cell, angle) = std::max(c_bLevels(cell, angle), adjBLevel + 1);
+            }
+        }
+        
+        #pragma omp critical
+        {
+            c_maxBLevel = std::max(c_maxBLevel, c_bLevels(cell, angle));
+        }
+    }
+    
+    
+    /*
+        getMaxBLevel
+    */
+    virtual UINT getMaxBLevel()
+    {
+        UINT maxBLevel;
+        
+        #pragma omp atomic read
+        maxBLevel = c_maxBLevel;
+        
+        return maxBLevel;
+    }
+    
+private:
+    Mat2<UINT> &c_bLevels;
+    Mat2<UINT> &c_sideBLevels;
+    UINT c_maxBLevel;
+};
+
+
+/*
+    NeighborPriorityData
+    
+    Calculates priorities when traversing a graph.
+    Can calculate BFDS, DFDS, or DFHDS depending on 
+    boundScale, boundShift, parentShift.
+    
+            boundScale   boundShift   parentShift
+    BFDS  =     1             0             0
+    DFDS  =     1         maxBLevel        -1
+    DFHDS =  maxBLevel    maxBLevel        -1
+    
+    Note: OpenMP assumes threading across angle.
+          Without this assumption, there could be a race condition.
+*/
+class NeighborPriorityData final : public TraverseData
+{
+public:
+    
+    /*
+        Constructor
+    */
+    NeighborPriorityData(Mat2<UINT> &priorities, const Mat2<UINT> &sideBLevels, 
+                         const UINT boundScale, const UINT boundShift, 
+                         const int parentShift)
+    : c_priorities(priorities), c_sideBLevels(sideBLevels), 
+      c_boundScale(boundScale), c_boundShift(boundShift), c_parentShift(parentShift)
+    {
+        c_priorities.setAll(0);
+    }
+    
+    
+    /*
+        data
+        
+        Return priority data given (cell, angle) pair.
+    */
+    virtual const char* getData(UINT cell, UINT face, UINT angle)
+    {
+        UNUSED_VARIABLE(face);
+        return (char*) (&c_priorities(cell, angle));
+    }
+    
+    
+    /*
+        getPriority
+        
+        Return a priority for the cell/angle pair.
+        Not needed for this class, so it is just set to a constant.
+    */
+    virtual UINT getPriority(UINT cell, UINT angle)
+    {
+        UNUSED_VARIABLE(cell);
+        UNUSED_VARIABLE(angle);
+        return 1;
+    }
+    
+    
+    /*
+        update
+        
+        Updates priority information for a given (cell, angle) pair.
+    */
+    virtual void update(UINT cell, UINT angle, 
+                        UINT adjCellsSides[g_nFacePerCell], 
+                        BoundaryType bdryType[g_nFacePerCell])
+    {
+        c_priorities(cell, angle) = 0;
+        
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            
+            UINT priority = 0;
+            
+            if (bdryType[face] == BoundaryType_OutIntBdry) {
+                UINT adjSide = adjCellsSides[face];
+                priority = c_sideBLevels(adjSide, angle) * c_boundScale + 
+                           c_boundShift;
+            }
+            
+            else if (bdryType[face] == BoundaryType_OutInt) {
+                UINT adjCell = adjCellsSides[face];
+                priority = c_priorities(adjCell, angle) + c_parentShift;
+            }
+            
+            c_priorities(cell, angle) = std::max(c_priorities(cell, angle), priority);
+        }
+    }
+    
+    
+    /*
+        These should never be called.
+        They are only used when communication is involved in traversing the
+        graph.
+    */
+    virtual void setSideData(UINT side, UINT angle, const char *data)
+    {
+        UNUSED_VARIABLE(side);
+        UNUSED_VARIABLE(angle);
+        UNUSED_VARIABLE(data);
+        Assert(false);
+    }
+    
+private:
+    Mat2<UINT> &c_priorities;
+    const Mat2<UINT> &c_sideBLevels;
+    const UINT c_boundScale;
+    const UINT c_boundShift;
+    const int c_parentShift;
+};
+
+
+/*
+    RemotePriorityData
+    
+    Calculates communication-cost-aware priorities when traversing a graph.
+    For each (cell, angle):
+    
+    remoteCost  = max over the off-rank faces downstream of the cell of 
+                  latencyCost + 1 + remote b-level of the face
+    remoteRanks = number of adjacent ranks fed downstream of the cell
+    priority    = local b-level + remoteCost + latencyCost * remoteRanks
+    
+    So cells feeding remote work are computed earlier, more so the more 
+    remote work and the more ranks they feed.  latencyCost is the cost of a
+    message in cell solves.  Reachable ranks are kept as a bitmask of 
+    adjacent rank indices (modulo 64).
+    
+    Note: OpenMP assumes threading across angle.
+          Without this assumption, there could be a race condition.
+*/
+class RemotePriorityData final : public TraverseData
+{
+public:
+    
+    /*
+        Constructor
+    */
+    RemotePriorityData(Mat2<UINT> &priorities, const Mat2<UINT> &bLevels,
+                       const Mat2<UINT> &sideBLevels, const UINT latencyCost)
+    : c_priorities(priorities), c_bLevels(bLevels), 
+      c_sideBLevels(sideBLevels), c_latencyCost(latencyCost),
+      c_remoteCost(g_nCells, g_nAngles), c_remoteRanks(g_nCells, g_nAngles)
+    {
+        c_priorities.setAll(0);
+        
+        for (UINT cell = 0; cell < g_nCells; cell++) {
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+            if (g_tychoMesh->getAdjCell(cell, face) == TychoMesh::BOUNDARY_FACE
+                && adjRank != TychoMesh::BAD_RANK &&
+                std::count(c_adjRanks.begin(), c_adjRanks.end(), adjRank) == 0)
+            {
+                c_adjRanks.push_back(adjRank);
+            }
+        }}
+        std::sort(c_adjRanks.begin(), c_adjRanks.end());
+    }
+    
+    
+    /*
+        getData
+        
+        Return priority data given (cell, angle) pair.
+    */
+    virtual const char* getData(UINT cell, UINT face, UINT angle)
+    {
+        UNUSED_VARIABLE(face);
+        return (char*) (&c_priorities(cell, angle));
+    }
+    
+    
+    /*
+        getPriority
+        
+        Return a priority for the cell/angle pair.
+        Not needed for this class, so it is just set to a constant.
+    */
+    virtual UINT getPriority(UINT cell, UINT angle)
+    {
+        UNUSED_VARIABLE(cell);
+        UNUSED_VARIABLE(angle);
+        return 1;
+    }
+    
+    
+    /*
+        update
+        
+        Updates priority information for a given (cell, angle) pair.
+    */
+    virtual void update(UINT cell, UINT angle, 
+                        UINT adjCellsSides[g_nFacePerCell], 
+                        BoundaryType bdryType[g_nFacePerCell])
+    {
+        UINT remoteCost = 0;
+        uint64_t remoteRanks = 0;
+        
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            
+            if (bdryType[face] == BoundaryType_OutIntBdry) {
+                UINT adjSide = adjCellsSides[face];
+                UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+                UINT rankIndex = 
+                    std::lower_bound(c_adjRanks.begin(), c_adjRanks.end(), 
+                                     adjRank) - c_adjRanks.begin();
+                remoteCost = std::max(remoteCost, c_latencyCost + 1 + 
+                                      c_sideBLevels(adjSide, angle));
+                remoteRanks |= (uint64_t)1 << (rankIndex % 64);
+            }
+            
+            else if (bdryType[face] == BoundaryType_OutInt) {
+                UINT adjCell = adjCellsSides[face];
+                remoteCost = std::max(remoteCost, c_remoteCost(adjCell, angle));
+                remoteRanks |= c_remoteRanks(adjCell, angle);
+            }
+        }
+        
+        c_remoteCost(cell, angle) = remoteCost;
+        c_remoteRanks(cell, angle) = remoteRanks;
+        c_priorities(cell, angle) = c_bLevels(cell, angle) + remoteCost + 
+            c_latencyCost * __builtin_popcountll(remoteRanks);
+    }
+    
+    
+    /*
+        These should never be called.
+        They are only used when communication is involved in traversing the
+        graph.
+    */
+    virtual void setSideData(UINT side, UINT angle, const char *data)
+    {
+        UNUSED_VARIABLE(side);
+        UNUSED_VARIABLE(angle);
+        UNUSED_VARIABLE(data);
+        Assert(false);
+    }
+    
+private:
+    Mat2<UINT> &c_priorities;
+    const Mat2<UINT> &c_bLevels;
+    const Mat2<UINT> &c_sideBLevels;
+    const UINT c_latencyCost;
+    Mat2<UINT> c_remoteCost;
+    Mat2<uint64_t> c_remoteRanks;
+    std::vector<UINT> c_adjRanks;
+};
+
+#endif
@@ -0,0 +1,210 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ScheduleCache.hh"
+#include "Global.hh"
+#include "TychoMesh.hh"
+#include "Comm.hh"
+#include "Assert.hh"
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+
+static const char CACHE_FORMAT_NAME[] = "TychoScheduleCache";
+static const UINT CACHE_FORMAT_NAME_LEN = sizeof(CACHE_FORMAT_NAME);
+
+
+/*
+    hashWord
+    
+    FNV-1a hash of the 8 bytes of word added to hash.
+*/
+static void hashWord(UINT word, UINT &hash)
+{
+    for (UINT byte = 0; byte < sizeof(UINT); byte++) {
+        hash ^= (word >> (8 * byte)) & 0xff;
+        hash *= 1099511628211ULL;
+    }
+}
+
+
+/*
+    hashDouble
+*/
+static void hashDouble(double value, UINT &hash)
+{
+    UINT word;
+    memcpy(&word, &value, sizeof(double));
+    hashWord(word, hash);
+}
+
+
+/*
+    getFilename
+*/
+static string getFilename(const string &name)
+{
+    return g_scheduleCache + "." + name + "." + to_string(Comm::rank());
+}
+
+
+namespace ScheduleCache
+{
+
+/*
+    getKey
+    
+    Returns the key for data depending on options.
+*/
+UINT getKey(const vector<UINT> &options)
+{
+    UINT hash = 14695981039346656037ULL;
+    
+    hashWord(Comm::rank(), hash);
+    hashWord(Comm::numRanks(), hash);
+    hashWord(g_nThreads, hash);
+    hashWord(g_snOrder, hash);
+    hashWord(g_nCells, hash);
+    hashWord(g_tychoMesh->getNSides(), hash);
+    hashWord(g_tychoMesh->getNNodes(), hash);
+    
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+        hashWord(g_tychoMesh->getLGCell(cell), hash);
+        
+        for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
+            UINT node = g_tychoMesh->getCellNode(cell, vrtx);
+            hashDouble(g_tychoMesh->getNodeCoord(node, 0), hash);
+            hashDouble(g_tychoMesh->getNodeCoord(node, 1), hash);
+            hashDouble(g_tychoMesh->getNodeCoord(node, 2), hash);
+        }
+        
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+            UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+            hashWord(adjCell, hash);
+            hashWord(adjRank, hash);
+            if (adjCell == TychoMesh::BOUNDARY_FACE && 
+                adjRank != TychoMesh::BAD_RANK)
+            {
+                UINT side = g_tychoMesh->getSide(cell, face);
+                hashWord(g_tychoMesh->getLGSide(side), hash);
+            }
+        }
+    }
+    
+    hashWord(options.size(), hash);
+    for (UINT option : options) {
+        hashWord(option, hash);
+    }
+    
+    return hash;
+}
+
+
+/*
+    read
+    
+    Reads the entry name from this rank's cache file.
+    Returns true if every rank read its entry with the right key.  
+    Otherwise the data must be recalculated (and written) on every rank, so
+    calculations with communication stay in sync.  Collective.
+*/
+bool read(const string &name, UINT key, vector<UINT> &data)
+{
+    if (g_scheduleCache.empty())
+        return false;
+    
+    UINT isStale = 1;
+    FILE *file = fopen(getFilename(name).c_str(), "rb");
+    
+    if (file != NULL) {
+        char formatName[CACHE_FORMAT_NAME_LEN];
+        UINT header[2];     // key, size
+        
+        if (fread(formatName, sizeof(char), CACHE_FORMAT_NAME_LEN, file) == 
+                CACHE_FORMAT_NAME_LEN &&
+            memcmp(formatName, CACHE_FORMAT_NAME, CACHE_FORMAT_NAME_LEN) == 0 &&
+            fread(header, sizeof(UINT), 2, file) == 2 &&
+            header[0] == key)
+        {
+            data.resize(header[1]);
+            if (fread(data.data(), sizeof(UINT), data.size(), file) == 
+                    data.size() &&
+                fgetc(file) == EOF)
+            {
+                isStale = 0;
+            }
+        }
+        
+        fclose(file);
+    }
+    
+    Comm::gmax(isStale);
+    return isStale == 0;
+}
+
+
+/*
+    write
+    
+    Writes the entry name to this rank's cache file.
+*/
+void write(const string &name, UINT key, const vector<UINT> &data)
+{
+    if (g_scheduleCache.empty())
+        return;
+    
+    FILE *file = fopen(getFilename(name).c_str(), "wb");
+    Insist(file != NULL, "Could not open schedule cache file.");
+    
+    UINT header[2] = {key, data.size()};
+    size_t numWritten = 0;
+    numWritten += fwrite(CACHE_FORMAT_NAME, sizeof(char), 
+                         CACHE_FORMAT_NAME_LEN, file);
+    numWritten += fwrite(header, sizeof(UINT), 2, file);
+    numWritten += fwrite(data.data(), sizeof(UINT), data.size(), file);
+    Insist(numWritten == CACHE_FORMAT_NAME_LEN + 2 + data.size(), 
+           "Could not write schedule cache file.");
+    
+    fclose(file);
+}
+
+} // End namespace
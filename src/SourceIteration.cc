@@ -45,6 +45,7 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Util.hh"
 #include "KrylovSolver.hh"
 #include <math.h>
+#include <algorithm>
 
 
 namespace
@@ -207,6 +208,101 @@ UINT fixedPoint(SweeperAbstract &sweeper, PsiData &psi, const PsiData &source)
 }
 
 
+/*
+    Block fixed point iteration
+    
+    Source iteration for several (psi, source) pairs at once using one
+    sweepMulti per iteration.  Iterates until all pairs have converged.
+*/
+UINT fixedPoint(SweeperAbstract &sweeper, std::vector<PsiData> &psi, 
+                const std::vector<PsiData> &source)
+{
+    // Data for problem
+    UINT numSources = psi.size();
+    std::vector<PsiData> totalSource(numSources);
+    std::vector<PhiData> phiNew(numSources);
+    std::vector<PhiData> phiOld(numSources);
+    
+    
+    // Get phi
+    for (UINT i = 0; i < numSources; i++) {
+        Util::psiToPhi(phiNew[i], psi[i]);
+    }
+    
+    
+    // Source iteration
+    UINT iter = 0;
+    double error = 1.0;
+    Timer totalTimer;
+    totalTimer.start();
+    while (iter < g_iterMax && error > g_errMax)
+    {
+        Timer timer;
+        double wallClockTime = 0.0;
+        timer.start();
+        
+
+        // phiOld = phiNew and totalSource = fixedSource + phiOld
+        for (UINT i = 0; i < numSources; i++) {
+            for (UINT j = 0; j < phiOld[i].size(); j++) {
+                phiOld[i][j] = phiNew[i][j];
+            }
+            Util::calcTotalSource(source[i], phiOld[i], totalSource[i]);
+        }
+
+        
+        // Sweep
+        sweeper.sweepMulti(psi, totalSource);
+        
+        
+        // Calculate max over sources of L_1 relative error for phi
+        error = 0.0;
+        for (UINT i = 0; i < numSources; i++) {
+            double sourceError = 0.0;
+            double norm = 0.0;
+            Util::psiToPhi(phiNew[i], psi[i]);
+            for (UINT j = 0; j < phiNew[i].size(); j++) {
+                sourceError += fabs(phiNew[i][j] - phiOld[i][j]);
+                norm += fabs(phiNew[i][j]);
+            }
+            Comm::gsum(sourceError);
+            Comm::gsum(norm);
+            error = std::max(error, sourceError / norm);
+        }
+        
+
+        // Print iteration stats
+        timer.stop();
+        wallClockTime = timer.wall_clock();
+        Comm::gmax(wallClockTime);
+        if(Comm::rank() == 0) {
+            printf("   iteration: %" PRIu64 "   error: %e   time: %f\n", 
+                   iter, error, wallClockTime);
+        }
+        
+
+        // Increment iteration
+        ++iter;
+    }
+    
+    
+    // Time total solve
+    totalTimer.stop();
+    double clockTime = totalTimer.wall_clock();
+    Comm::gmax(clockTime);
+    if(Comm::rank() == 0) {
+        printf("\nTotal block source iteration time (%" PRIu64 " sources): "
+               "%.2f\n", numSources, clockTime);
+        printf("Average block source iteration time: %.2f\n\n",
+               clockTime / iter);
+    }
+
+
+    // Return number of iterations
+    return iter;
+}
+
+
 /*
     Krylov solver
 
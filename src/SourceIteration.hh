@@ -43,11 +43,14 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "SweeperAbstract.hh"
 #include "Global.hh"
+#include <vector>
 
 namespace SourceIteration
 {
 
 UINT fixedPoint(SweeperAbstract &sweeper, PsiData &psi, const PsiData &source);
+UINT fixedPoint(SweeperAbstract &sweeper, std::vector<PsiData> &psi, 
+                const std::vector<PsiData> &source);
 UINT krylov(SweeperAbstract &sweeper, PsiData &psi, const PsiData &source);
 
 } // End namespace
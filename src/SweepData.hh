@@ -45,42 +45,78 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "GraphTraverser.hh"
 #include "Transport.hh"
 #include "Global.hh"
+#include "Comm.hh"
+#include "CommSides.hh"
 #include <stddef.h>
+#include <string.h>
 #include <omp.h>
+#include <algorithm>
+#include <vector>
 
 /*
     SweepData
     
     Holds psi and other data for the sweep.
+    
+    The energy groups can be split into nGroupBlocks blocks which are swept
+    independently.  Then the angle passed to the TraverseData methods is
+    groupBlock * g_nAngles + angle, and data for a (cell, face, angle) 
+    only holds the groups in the block.
+    
+    If commSides is given, psi on outgoing boundary sides is put to it as 
+    soon as it is computed.
 */
-class SweepData : public TraverseData
+class SweepData final : public TraverseData
 {
 public:
     
     SweepData(PsiData &psi, const PsiData &source, PsiBoundData &psiBound,  
-               const Mat2<UINT> &priorities)
+               const Mat2<UINT> &priorities, UINT nGroupBlocks = 1,
+               CommSides *commSides = NULL)
     : c_psi(psi), c_psiBound(psiBound), c_source(source), 
       c_priorities(priorities), c_localFaceData(g_nThreads),
       c_localSource(g_nThreads), c_localPsi(g_nThreads),
-      c_localPsiBound(g_nThreads)
+      c_localPsiBound(g_nThreads), c_localWireData(g_nThreads), 
+      c_nGroupBlocks(nGroupBlocks),
+      c_groupBlockSize(getGroupBlockSize(nGroupBlocks)),
+      c_commSides(commSides)
     {
+        Assert(commSides == NULL || nGroupBlocks == 1);
+        
         for (UINT angleGroup = 0; angleGroup < g_nThreads; angleGroup++) {
-            c_localFaceData[angleGroup].resize(g_nVrtxPerFace, g_nGroups);
+            c_localFaceData[angleGroup].resize(g_nVrtxPerFace, 
+                                               c_groupBlockSize);
             c_localSource[angleGroup].resize(g_nVrtxPerCell, g_nGroups);
             c_localPsi[angleGroup].resize(g_nVrtxPerCell, g_nGroups);
             c_localPsiBound[angleGroup].resize(g_nVrtxPerFace, g_nFacePerCell, 
                                                g_nGroups);
+            c_localWireData[angleGroup].resize(getDataSizeInBytes(nGroupBlocks));
         }
     }
     
 
+    /*
+        getGroupBlockSize
+        
+        Max number of groups in a group block.
+    */
+    static
+    UINT getGroupBlockSize(UINT nGroupBlocks)
+    {
+        return (g_nGroups + nGroupBlocks - 1) / nGroupBlocks;
+    }
+    
+    
     /*
         getDataSizeInBytes
+        
+        Size of the data sent for a (cell, face, angle) tuple.
     */
     static
-    size_t getDataSizeInBytes()
+    size_t getDataSizeInBytes(UINT nGroupBlocks = 1)
     {
-        return g_nGroups * g_nVrtxPerFace * sizeof(double);
+        return getGroupBlockSize(nGroupBlocks) * g_nVrtxPerFace * 
+               Comm::wireRealSize();
     }
     
     
@@ -92,13 +128,22 @@ public:
     virtual const char* getData(UINT cell, UINT face, UINT angle)
     {
         Mat2<double> &localFaceData = c_localFaceData[omp_get_thread_num()];
+        UINT groupBegin, groupEnd;
+        splitAngle(angle, groupBegin, groupEnd);
         
-        for (UINT group = 0; group < g_nGroups; group++) {
+        for (UINT group = groupBegin; group < groupEnd; group++) {
         for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
             UINT vrtx = g_tychoMesh->getFaceToCellVrtx(cell, face, fvrtx);
-            localFaceData(fvrtx, group) = c_psi(group, vrtx, angle, cell);
+            localFaceData(fvrtx, group - groupBegin) = 
+                c_psi(group, vrtx, angle, cell);
         }}
         
+        if (g_useSinglePrecisionComm) {
+            char *wireData = c_localWireData[omp_get_thread_num()].data();
+            Comm::realsToWire(&localFaceData[0], localFaceData.size(), 
+                              wireData);
+            return wireData;
+        }
         return (char*) (&localFaceData[0]);
     }
        
@@ -110,12 +155,15 @@ public:
     */
     virtual void setSideData(UINT side, UINT angle, const char *data)
     {
-        Mat2<double> localFaceData(g_nVrtxPerFace, g_nGroups);
-        localFaceData.setData((double*)data);
+        Mat2<double> localFaceData(g_nVrtxPerFace, c_groupBlockSize);
+        Comm::wireToReals(data, localFaceData.size(), &localFaceData[0]);
+        UINT groupBegin, groupEnd;
+        splitAngle(angle, groupBegin, groupEnd);
         
         for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
-        for (UINT group = 0; group < g_nGroups; group++) {
-            c_psiBound(group, fvrtx, angle, side) = localFaceData(fvrtx, group);
+        for (UINT group = groupBegin; group < groupEnd; group++) {
+            c_psiBound(group, fvrtx, angle, side) = 
+                localFaceData(fvrtx, group - groupBegin);
         }}
     }
 
@@ -124,10 +172,15 @@ public:
         getPriority
         
         Return a priority for the cell/angle pair.
+        Ties between group blocks go to the lower block so it is sent 
+        downstream first.
     */
     virtual UINT getPriority(UINT cell, UINT angle)
     {
-        return c_priorities(cell, angle);
+        UINT groupBlock = angle / g_nAngles;
+        angle = angle % g_nAngles;
+        return c_priorities(cell, angle) * c_nGroupBlocks + 
+               (c_nGroupBlocks - 1 - groupBlock);
     }
     
     
@@ -140,17 +193,16 @@ public:
                         UINT adjCellsSides[g_nFacePerCell], 
                         BoundaryType bdryType[g_nFacePerCell])
     {
-        UNUSED_VARIABLE(adjCellsSides);
-        UNUSED_VARIABLE(bdryType);
-        
         Mat2<double> &localSource = c_localSource[omp_get_thread_num()];
         Mat2<double> &localPsi = c_localPsi[omp_get_thread_num()];
         Mat3<double> &localPsiBound = c_localPsiBound[omp_get_thread_num()];
+        UINT groupBegin, groupEnd;
+        splitAngle(angle, groupBegin, groupEnd);
 
         
         // Populate localSource
         #pragma omp simd
-        for (UINT group = 0; group < g_nGroups; group++) {
+        for (UINT group = groupBegin; group < groupEnd; group++) {
         for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
             localSource(vrtx, group) = c_source(group, vrtx, angle, cell);
         }}
@@ -158,22 +210,49 @@ public:
         
         // Populate localPsiBound
         Transport::populateLocalPsiBound(angle, cell, c_psi, c_psiBound, 
-                                         localPsiBound);
+                                         localPsiBound, groupBegin, groupEnd);
         
         
         // Transport solve
         Transport::solve(cell, angle, g_sigmaT[cell],
-                         localPsiBound, localSource, localPsi);
+                         localPsiBound, localSource, localPsi, 
+                         groupBegin, groupEnd);
         
         
         // localPsi -> psi
-        for (UINT group = 0; group < g_nGroups; group++) {
+        for (UINT group = groupBegin; group < groupEnd; group++) {
         for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
             c_psi(group, vrtx, angle, cell) = localPsi(vrtx, group);
         }}
+        
+        
+        // Stream outgoing boundary psi
+        if (c_commSides != NULL) {
+            for (UINT face = 0; face < g_nFacePerCell; face++) {
+                if (bdryType[face] == BoundaryType_OutIntBdry)
+                    c_commSides->putSide(adjCellsSides[face], angle, c_psi);
+            }
+            if (omp_get_thread_num() == 0)
+                c_commSides->progressSides();
+        }
     }
     
 private:
+    
+    /*
+        splitAngle
+        
+        Splits groupBlock * g_nAngles + angle into the angle and the 
+        groups [groupBegin, groupEnd) of the group block.
+    */
+    void splitAngle(UINT &angle, UINT &groupBegin, UINT &groupEnd) const
+    {
+        UINT groupBlock = angle / g_nAngles;
+        angle = angle % g_nAngles;
+        groupBegin = groupBlock * c_groupBlockSize;
+        groupEnd = std::min(groupBegin + c_groupBlockSize, g_nGroups);
+    }
+    
     PsiData &c_psi;
     PsiBoundData &c_psiBound;
     const PsiData &c_source;
@@ -182,6 +261,115 @@ private:
     std::vector<Mat2<double>> c_localSource;
     std::vector<Mat2<double>> c_localPsi;
     std::vector<Mat3<double>> c_localPsiBound;
+    std::vector<std::vector<char>> c_localWireData;
+    UINT c_nGroupBlocks;
+    UINT c_groupBlockSize;
+    CommSides *c_commSides;
+};
+
+
+/*
+    MultiSweepData
+    
+    Holds psi and other data to sweep several (psi, source) pairs in one
+    traversal.  The data for a (cell, face, angle) tuple is the data of
+    each pair one after the other.
+*/
+class MultiSweepData final : public TraverseData
+{
+public:
+    
+    MultiSweepData(std::vector<PsiData> &psi, 
+                   const std::vector<PsiData> &source, 
+                   std::vector<PsiBoundData> &psiBound,  
+                   const Mat2<UINT> &priorities, UINT nGroupBlocks = 1)
+    : c_localData(g_nThreads), 
+      c_dataSize(SweepData::getDataSizeInBytes(nGroupBlocks))
+    {
+        Assert(psi.size() == source.size());
+        Assert(psi.size() == psiBound.size());
+        
+        for (UINT i = 0; i < psi.size(); i++) {
+            c_sweepData.emplace_back(psi[i], source[i], psiBound[i], 
+                                     priorities, nGroupBlocks);
+        }
+        
+        for (UINT angleGroup = 0; angleGroup < g_nThreads; angleGroup++) {
+            c_localData[angleGroup].resize(psi.size() * c_dataSize);
+        }
+    }
+    
+    
+    /*
+        getDataSizeInBytes
+    */
+    static
+    size_t getDataSizeInBytes(UINT nSources, UINT nGroupBlocks = 1)
+    {
+        return nSources * SweepData::getDataSizeInBytes(nGroupBlocks);
+    }
+    
+    
+    /*
+        data
+        
+        Return psi for each (psi, source) pair at the (cell,face,angle) tuple
+    */
+    virtual const char* getData(UINT cell, UINT face, UINT angle)
+    {
+        char *localData = c_localData[omp_get_thread_num()].data();
+        
+        for (UINT i = 0; i < c_sweepData.size(); i++) {
+            memcpy(localData + i * c_dataSize, 
+                   c_sweepData[i].getData(cell, face, angle), c_dataSize);
+        }
+        
+        return localData;
+    }
+    
+    
+    /*
+        sideData
+        
+        Set psiBound of each (psi, source) pair for the (side, angle) pair.
+    */
+    virtual void setSideData(UINT side, UINT angle, const char *data)
+    {
+        for (UINT i = 0; i < c_sweepData.size(); i++) {
+            c_sweepData[i].setSideData(side, angle, data + i * c_dataSize);
+        }
+    }
+    
+    
+    /*
+        getPriority
+        
+        Return a priority for the cell/angle pair.
+    */
+    virtual UINT getPriority(UINT cell, UINT angle)
+    {
+        return c_sweepData[0].getPriority(cell, angle);
+    }
+    
+    
+    /*
+        update
+        
+        Does a transport update for each (psi, source) pair.
+    */
+    virtual void update(UINT cell, UINT angle, 
+                        UINT adjCellsSides[g_nFacePerCell], 
+                        BoundaryType bdryType[g_nFacePerCell])
+    {
+        for (UINT i = 0; i < c_sweepData.size(); i++) {
+            c_sweepData[i].update(cell, angle, adjCellsSides, bdryType);
+        }
+    }
+    
+private:
+    std::vector<SweepData> c_sweepData;
+    std::vector<std::vector<char>> c_localData;
+    size_t c_dataSize;
 };
 
 #endif
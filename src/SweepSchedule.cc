@@ -43,6 +43,7 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "TychoMesh.hh"
 #include "Mat.hh"
 #include "Priorities.hh"
+#include "ScheduleCache.hh"
 
 #include <cmath>
 #include <algorithm>
@@ -668,15 +669,94 @@ void anglePriorities(Mat2<UINT> &priorities, const UINT numAngles,
 }
 
 
+/*
+    toCacheData
+    
+    Flattens the schedule.  For each step: number of work units, then 
+    (cell, angle) for each, then number and list of send procs and recv 
+    procs.
+*/
+void SweepSchedule::toCacheData(std::vector<UINT> &data) const
+{
+    data.clear();
+    data.push_back(c_workOrders.size());
+    for (UINT step = 0; step < c_workOrders.size(); step++) {
+        data.push_back(c_workOrders[step].size());
+        for (const Work &work : c_workOrders[step]) {
+            data.push_back(work.getCell());
+            data.push_back(work.getAngle());
+        }
+        data.push_back(c_sendProcs[step].size());
+        data.insert(data.end(), c_sendProcs[step].begin(), 
+                    c_sendProcs[step].end());
+        data.push_back(c_recvProcs[step].size());
+        data.insert(data.end(), c_recvProcs[step].begin(), 
+                    c_recvProcs[step].end());
+    }
+}
+
+
+/*
+    fromCacheData
+    
+    Inverse of toCacheData.
+*/
+void SweepSchedule::fromCacheData(const std::vector<UINT> &data)
+{
+    UINT index = 0;
+    UINT nSteps = data.at(index++);
+    c_workOrders.resize(nSteps);
+    c_sendProcs.resize(nSteps);
+    c_recvProcs.resize(nSteps);
+    
+    for (UINT step = 0; step < nSteps; step++) {
+        UINT nWork = data.at(index++);
+        for (UINT i = 0; i < nWork; i++) {
+            UINT cell = data.at(index++);
+            UINT angle = data.at(index++);
+            c_workOrders[step].push_back(Work(cell, angle));
+        }
+        UINT nSendProcs = data.at(index++);
+        for (UINT i = 0; i < nSendProcs; i++) {
+            c_sendProcs[step].push_back(data.at(index++));
+        }
+        UINT nRecvProcs = data.at(index++);
+        for (UINT i = 0; i < nRecvProcs; i++) {
+            c_recvProcs[step].push_back(data.at(index++));
+        }
+    }
+    Insist(index == data.size(), "Schedule cache has wrong size.");
+}
+
+
 /*
     Constructor
     Note: function to break cyclic dependencies is not implemented
+    
+    The schedule is read from the schedule cache if it is there.
+    Otherwise it is calculated and written to the cache.
 */
 SweepSchedule::SweepSchedule(const std::vector<UINT> &angles,
                              const UINT maxCellsPerStep,
                              const UINT intraAngleP, 
                              const UINT interAngleP)
 {
+    // Read from the cache
+    vector<UINT> cacheData;
+    string cacheName = 
+        "schedule" + to_string(angles.empty() ? 0 : angles[0]);
+    vector<UINT> cacheOptions = 
+        {maxCellsPerStep, intraAngleP, interAngleP, angles.size()};
+    cacheOptions.insert(cacheOptions.end(), angles.begin(), angles.end());
+    UINT cacheKey = ScheduleCache::getKey(cacheOptions);
+    if (ScheduleCache::read(cacheName, cacheKey, cacheData)) {
+        fromCacheData(cacheData);
+        if (Comm::rank() == 0)
+            printf("   Sweep schedule read from schedule cache\n");
+        return;
+    }
+    
+    
     // Get processors neighboring this processor
     set<UINT> neighborProcs;
     calcNeighborProcs(neighborProcs);
@@ -732,5 +812,10 @@ SweepSchedule::SweepSchedule(const std::vector<UINT> &angles,
     // Calculate the Ordering
     calcOrdering(hasChild, hasParent, priorities, neighborProcs, angles.size(), 
                  maxCellsPerStep, angles, c_workOrders, c_sendProcs, c_recvProcs);
+    
+    
+    // Write to the cache
+    toCacheData(cacheData);
+    ScheduleCache::write(cacheName, cacheKey, cacheData);
 }
 
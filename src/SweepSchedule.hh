@@ -79,6 +79,9 @@ class SweepSchedule
     
     
   private:
+    void toCacheData(std::vector<UINT> &data) const;
+    void fromCacheData(const std::vector<UINT> &data);
+    
     // work to be performed in each step
     std::vector<std::vector<Work> > c_workOrders;
     // processors to send data to after each step
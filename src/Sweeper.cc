@@ -113,7 +113,8 @@ void setBoundData(PsiBoundData &psiBound, const vector<UINT> &commSides,
 static
 void send(const UINT step, const UINT angleGroup,
           Mat2<vector<UINT>> &commSidesAngles, Mat2<vector<double>> &commPsi,
-          vector<MPI_Request> &mpiRequests)
+          Mat2<vector<float>> &commPsiFloat, vector<MPI_Request> &mpiRequests,
+          MPI_Comm comm)
 {
     if (step < g_sweepSchedule[angleGroup]->nSteps()) {
         for (UINT proc : g_sweepSchedule[angleGroup]->getSendProcs(step)) {
@@ -126,14 +127,23 @@ void send(const UINT step, const UINT angleGroup,
             int tag1 = angleGroup * 3 + 1;
             int tag2 = angleGroup * 3 + 2;
     
-            Comm::iSendUIntVector(nSidesData, proc, tag0, mpiRequest);
+            Comm::iSendUIntVector(nSidesData, proc, tag0, mpiRequest, comm);
             mpiRequests.push_back(mpiRequest);
             if (nSides > 0) {
                 Comm::iSendUIntVector(commSidesAngles(angleGroup, proc), proc, 
-                                     tag1, mpiRequest);
+                                     tag1, mpiRequest, comm);
                 mpiRequests.push_back(mpiRequest);
-                Comm::iSendDoubleVector(commPsi(angleGroup, proc), proc, 
-                                        tag2, mpiRequest);
+                if (g_useSinglePrecisionComm) {
+                    commPsiFloat(angleGroup, proc).assign(
+                        commPsi(angleGroup, proc).begin(), 
+                        commPsi(angleGroup, proc).end());
+                    Comm::iSendFloatVector(commPsiFloat(angleGroup, proc), 
+                                           proc, tag2, mpiRequest, comm);
+                }
+                else {
+                    Comm::iSendDoubleVector(commPsi(angleGroup, proc), proc, 
+                                            tag2, mpiRequest, comm);
+                }
                 mpiRequests.push_back(mpiRequest);
             }
             
@@ -150,7 +160,8 @@ void send(const UINT step, const UINT angleGroup,
     Receive side data.
 */
 static
-void recv(const UINT step, const UINT angleGroup, PsiBoundData &psiBound)
+void recv(const UINT step, const UINT angleGroup, PsiBoundData &psiBound,
+          MPI_Comm comm)
 {
     if (step < g_sweepSchedule[angleGroup]->nSteps()) {
         for (UINT proc : g_sweepSchedule[angleGroup]->getRecvProcs(step)) {
@@ -161,7 +172,7 @@ void recv(const UINT step, const UINT angleGroup, PsiBoundData &psiBound)
             int tag1 = angleGroup * 3 + 1;
             int tag2 = angleGroup * 3 + 2;
     
-            Comm::recvUIntVector(nSidesData, proc, tag0);
+            Comm::recvUIntVector(nSidesData, proc, tag0, comm);
             UINT nSides = nSidesData[0];
             UINT nData = nSidesData[1];
     
@@ -170,8 +181,15 @@ void recv(const UINT step, const UINT angleGroup, PsiBoundData &psiBound)
                 // Receive data
                 vector<UINT> commSidesAngles(2*nSides);
                 vector<double> commPsi(nData);
-                Comm::recvUIntVector(commSidesAngles, proc, tag1);
-                Comm::recvDoubleVector(commPsi, proc, tag2);
+                Comm::recvUIntVector(commSidesAngles, proc, tag1, comm);
+                if (g_useSinglePrecisionComm) {
+                    vector<float> commPsiFloat(nData);
+                    Comm::recvFloatVector(commPsiFloat, proc, tag2, comm);
+                    commPsi.assign(commPsiFloat.begin(), commPsiFloat.end());
+                }
+                else {
+                    Comm::recvDoubleVector(commPsi, proc, tag2, comm);
+                }
     
                 // Pull apart side and angle data
                 // Convert side data to local side indexing
@@ -315,7 +333,8 @@ void doComputation(const UINT step,
 
     Splits all the angles into sets of angle groups.
     One angle group per OMP thread.
-    Creates an array of SweepSchedules, one entry for each angle group.
+    Creates an array of SweepSchedules, one entry for each angle group,
+    and a communicator for each angle group.
 */
 Sweeper::Sweeper()
 {
@@ -347,6 +366,27 @@ Sweeper::Sweeper()
             new SweepSchedule(angles, g_maxCellsPerStep, g_intraAngleP, 
                               g_interAngleP);
     }
+    
+    
+    // A communicator for each angle group so each thread can communicate
+    // on its own (MPI_THREAD_MULTIPLE)
+    c_angleGroupComms.resize(g_nAngleGroups);
+    for (UINT angleGroup = 0; angleGroup < g_nAngleGroups; angleGroup++) {
+        int mpiError = MPI_Comm_dup(MPI_COMM_WORLD, 
+                                    &c_angleGroupComms[angleGroup]);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+}
+
+
+/*
+    Destructor
+*/
+Sweeper::~Sweeper()
+{
+    for (MPI_Comm &comm : c_angleGroupComms) {
+        MPI_Comm_free(&comm);
+    }
 }
 
 
@@ -390,6 +430,7 @@ void Sweeper::sweep(PsiData &psi, const PsiData &source, bool zeroPsiBound)
     // Communication variables
     Mat2<vector<UINT>> commSidesAngles(g_nAngleGroups, Comm::numRanks());
     Mat2<vector<double>> commPsi(g_nAngleGroups, Comm::numRanks());
+    Mat2<vector<float>> commPsiFloat(g_nAngleGroups, Comm::numRanks());
     PsiBoundData psiBound;
     
     
@@ -423,11 +464,13 @@ void Sweeper::sweep(PsiData &psi, const PsiData &source, bool zeroPsiBound)
             vector<MPI_Request> mpiRequests;
             
             for (UINT angleGroup = 0; angleGroup < g_nAngleGroups; angleGroup++) {    
-                send(step, angleGroup, commSidesAngles, commPsi, mpiRequests);
+                send(step, angleGroup, commSidesAngles, commPsi, 
+                     commPsiFloat, mpiRequests, c_angleGroupComms[angleGroup]);
             }
             
             for (UINT angleGroup = 0; angleGroup < g_nAngleGroups; angleGroup++) {
-                recv(step, angleGroup, psiBound);
+                recv(step, angleGroup, psiBound, 
+                     c_angleGroupComms[angleGroup]);
             }
             
             MPI_Waitall(mpiRequests.size(), &mpiRequests[0], MPI_STATUSES_IGNORE);
@@ -439,11 +482,9 @@ void Sweeper::sweep(PsiData &psi, const PsiData &source, bool zeroPsiBound)
     // Sweep Type 1
     // Overlaps computation and communication between threads
     // No omp barrier
+    // Each thread communicates on its own communicator (MPI_THREAD_MULTIPLE)
     if (g_sweepType == SweepType_OriginalTycho2) {
         
-        // Thread ID allowed to communicate
-        UINT commNumber = 0;
-        
         // Do the sweep
         #pragma omp parallel
         {
@@ -460,32 +501,14 @@ void Sweeper::sweep(PsiData &psi, const PsiData &source, bool zeroPsiBound)
                 computationTimes[angleGroup] += timer1.wall_clock();
                 
                 
-                // Require communication in thread id order
-                while(true) {
-                    double temp;
-                    #pragma omp atomic read
-                    temp = commNumber;
-                    if (temp == angleGroup)
-                        break;
-                }
-                
-                
                 // Nonblocking send and blocking recv
                 vector<MPI_Request> mpiRequests;
-                send(step, angleGroup, commSidesAngles, commPsi, mpiRequests);
-                recv(step, angleGroup, psiBound);
-                MPI_Waitall(mpiRequests.size(), &mpiRequests[0], 
+                send(step, angleGroup, commSidesAngles, commPsi, 
+                     commPsiFloat, mpiRequests, c_angleGroupComms[angleGroup]);
+                recv(step, angleGroup, psiBound, 
+                     c_angleGroupComms[angleGroup]);
+                MPI_Waitall(mpiRequests.size(), mpiRequests.data(), 
                             MPI_STATUSES_IGNORE);
-                
-                
-                // Barrier all MPI ranks for thread 'commNumber'
-                Comm::barrier();
-                
-                
-                // Allow next thread to communicate
-                #pragma omp atomic write
-                commNumber = (angleGroup + 1) % g_nAngleGroups;
-                
             }
         }
     }
@@ -42,16 +42,19 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "PsiData.hh"
 #include "SweeperAbstract.hh"
+#include <mpi.h>
+#include <vector>
 
 class Sweeper : public SweeperAbstract
 {
 public:
     Sweeper();
+    ~Sweeper();
     void sweep(PsiData &psi, const PsiData &source, bool zeroPsiBound);
     void solve();
 
 private:
-
+    std::vector<MPI_Comm> c_angleGroupComms;    // Duplicate of MPI_COMM_WORLD
 };
 
 
@@ -42,6 +42,7 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "PsiData.hh"
 #include <string>
+#include <vector>
 
 
 class SweeperAbstract
@@ -53,6 +54,15 @@ public:
 
     virtual
     void solve() = 0;
+    
+    // Sweeps several (psi, source) pairs.  Default is one at a time.
+    virtual
+    void sweepMulti(std::vector<PsiData> &psi, 
+                    const std::vector<PsiData> &source)
+    {
+        for (size_t i = 0; i < psi.size(); i++)
+            sweep(psi[i], source[i]);
+    }
 
     void writePsiToFile(std::string &filename)
     {
@@ -0,0 +1,355 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "SweeperLevels.hh"
+#include "SourceIteration.hh"
+#include "Problem.hh"
+#include "SweepData.hh"
+#include "Global.hh"
+#include "Priorities.hh"
+#include "PsiData.hh"
+#include "TychoMesh.hh"
+#include "Comm.hh"
+#include "Timer.hh"
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <mpi.h>
+
+using namespace std;
+
+
+/*
+    SweeperLevels constructor
+    
+    Calculates global b-levels and sorts the (cell, angle) pairs into 
+    batches by level.  Level 0 is the highest b-level, so all parents of a 
+    (cell, angle) pair are in earlier levels.
+    Also precomputes the packets sent to/received from adjacent ranks after 
+    each level.
+*/
+SweeperLevels::SweeperLevels()
+{
+    // Global b-levels
+    Mat2<UINT> bLevels(g_nCells, g_nAngles);
+    UINT maxBLevel = Priorities::calcGlobalBLevels(bLevels);
+    c_nLevels = maxBLevel + 1;
+    
+    if (Comm::rank() == 0)
+        printf("Num levels: %" PRIu64 "\n", c_nLevels);
+    
+    
+    // Sort (cell, angle) pairs into batches by level
+    c_levelOffsets.assign(c_nLevels + 1, 0);
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT angle = 0; angle < g_nAngles; angle++) {
+        UINT level = maxBLevel - bLevels(cell, angle);
+        c_levelOffsets[level + 1]++;
+    }}
+    
+    for (UINT level = 0; level < c_nLevels; level++) {
+        c_levelOffsets[level + 1] += c_levelOffsets[level];
+    }
+    
+    vector<UINT> batchIndex(c_levelOffsets.begin(), c_levelOffsets.end() - 1);
+    c_batchCells.resize(g_nCells * g_nAngles);
+    c_batchAngles.resize(g_nCells * g_nAngles);
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT angle = 0; angle < g_nAngles; angle++) {
+        UINT level = maxBLevel - bLevels(cell, angle);
+        c_batchCells[batchIndex[level]] = cell;
+        c_batchAngles[batchIndex[level]] = angle;
+        batchIndex[level]++;
+    }}
+    
+    
+    // Get adjacent ranks
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
+        
+        UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+        UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+        
+        if (adjCell == TychoMesh::BOUNDARY_FACE && 
+            adjRank != TychoMesh::BAD_RANK &&
+            std::count(c_adjRanks.begin(), c_adjRanks.end(), adjRank) == 0)
+        {
+            c_adjRanks.push_back(adjRank);
+        }
+    }}
+    UINT numAdjRanks = c_adjRanks.size();
+    
+    
+    // Send metadata for each level and adjacent rank
+    c_sendMetaData.resize(c_nLevels, numAdjRanks);
+    for (UINT level = 0; level < c_nLevels; level++) {
+    for (UINT i = c_levelOffsets[level]; i < c_levelOffsets[level+1]; i++) {
+        
+        UINT cell = c_batchCells[i];
+        UINT angle = c_batchAngles[i];
+        
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            
+            UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+            UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+            
+            if (adjCell == TychoMesh::BOUNDARY_FACE && 
+                adjRank != TychoMesh::BAD_RANK &&
+                g_tychoMesh->isOutgoing(angle, cell, face))
+            {
+                UINT rankIndex = 
+                    std::find(c_adjRanks.begin(), c_adjRanks.end(), adjRank) - 
+                    c_adjRanks.begin();
+                
+                MetaData md;
+                UINT side = g_tychoMesh->getSide(cell, face);
+                md.gSide = g_tychoMesh->getLGSide(side);
+                md.angle = angle;
+                md.cell  = cell;
+                md.face  = face;
+                c_sendMetaData(level, rankIndex).push_back(md);
+            }
+        }
+    }}
+    
+    
+    // Exchange number of packets per level with adjacent ranks
+    c_numRecvPackets.resize(c_nLevels, numAdjRanks);
+    vector<vector<UINT>> numSendPackets(numAdjRanks);
+    vector<vector<UINT>> numRecvPackets(numAdjRanks);
+    vector<MPI_Request> mpiRequests(2 * numAdjRanks);
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        
+        numSendPackets[rankIndex].resize(c_nLevels);
+        numRecvPackets[rankIndex].resize(c_nLevels);
+        for (UINT level = 0; level < c_nLevels; level++) {
+            numSendPackets[rankIndex][level] = 
+                c_sendMetaData(level, rankIndex).size();
+        }
+        
+        int tag = 0;
+        int adjRank = c_adjRanks[rankIndex];
+        int mpiError = MPI_Irecv(numRecvPackets[rankIndex].data(), c_nLevels, 
+                                 MPI_UINT64_T, adjRank, tag, MPI_COMM_WORLD, 
+                                 &mpiRequests[2 * rankIndex]);
+        Insist(mpiError == MPI_SUCCESS, "");
+        Comm::iSendUIntVector(numSendPackets[rankIndex], adjRank, tag, 
+                              mpiRequests[2 * rankIndex + 1]);
+    }
+    
+    if (numAdjRanks > 0) {
+        int mpiError = MPI_Waitall(mpiRequests.size(), mpiRequests.data(), 
+                                   MPI_STATUSES_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+    
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+    for (UINT level = 0; level < c_nLevels; level++) {
+        c_numRecvPackets(level, rankIndex) = numRecvPackets[rankIndex][level];
+    }}
+}
+
+
+/*
+    solve
+*/
+void SweeperLevels::solve()
+{
+    Problem::getSource(c_source);
+    c_psi.setToValue(0.0);
+
+    if (g_useSourceIteration)
+        SourceIteration::fixedPoint(*this, c_psi, c_source);
+    else
+        SourceIteration::krylov(*this, c_psi, c_source);
+}
+
+
+/*
+    SweeperLevels::sweep
+    
+    Sweep one level at a time.
+    The algorithm for each level is
+    - Solve all (cell, angle) pairs in the level with a parallel for
+    - Irecv packets from adjacent ranks expecting data for this level
+    - Isend packets (global side, angle, psi) to adjacent ranks
+    - Wait on recvs and put data into psiBound
+*/
+void SweeperLevels::sweep(PsiData &psi, const PsiData &source, 
+                          bool zeroPsiBound)
+{
+    UNUSED_VARIABLE(zeroPsiBound);
+    
+    
+    // Variables
+    UINT numAdjRanks = c_adjRanks.size();
+    UINT dataSize = SweepData::getDataSizeInBytes();
+    UINT packetSize = 2 * sizeof(UINT) + dataSize;
+    vector<vector<char>> dataToSend(numAdjRanks);
+    vector<vector<char>> dataToRecv(numAdjRanks);
+    vector<MPI_Request> mpiRecvRequests(numAdjRanks);
+    vector<MPI_Request> mpiSendRequests(numAdjRanks);
+    PsiBoundData psiBound;
+    Mat2<UINT> priorities;  // Priorities are not used in a level sweep
+    SweepData sweepData(psi, source, psiBound, priorities);
+    Timer totalTimer;
+    Timer computeTimer;
+    Timer commTimer;
+    
+    
+    // Sweep each level
+    totalTimer.start();
+    for (UINT level = 0; level < c_nLevels; level++) {
+        
+        // Solve the batch of (cell, angle) pairs for this level
+        computeTimer.start();
+        #pragma omp parallel for schedule(static)
+        for (UINT i = c_levelOffsets[level]; i < c_levelOffsets[level+1]; i++) {
+            UINT adjCellsSides[g_nFacePerCell];
+            BoundaryType bdryType[g_nFacePerCell];
+            sweepData.update(c_batchCells[i], c_batchAngles[i], 
+                             adjCellsSides, bdryType);
+        }
+        computeTimer.stop();
+        
+        
+        // Communicate partition boundary data
+        commTimer.start();
+        int mpiError;
+        UINT numToRecv = 0;
+        for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+            
+            UINT numPackets = c_numRecvPackets(level, rankIndex);
+            if (numPackets > 0) {
+                int tag = 0;
+                int adjRank = c_adjRanks[rankIndex];
+                dataToRecv[rankIndex].resize(numPackets * packetSize);
+                mpiError = MPI_Irecv(dataToRecv[rankIndex].data(), 
+                                     dataToRecv[rankIndex].size(), 
+                                     MPI_BYTE, adjRank, tag, MPI_COMM_WORLD,
+                                     &mpiRecvRequests[rankIndex]);
+                Insist(mpiError == MPI_SUCCESS, "");
+                numToRecv++;
+            }
+            else {
+                mpiRecvRequests[rankIndex] = MPI_REQUEST_NULL;
+            }
+        }
+        
+        for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+            
+            const vector<MetaData> &metaData = 
+                c_sendMetaData(level, rankIndex);
+            if (metaData.size() > 0) {
+                dataToSend[rankIndex].resize(metaData.size() * packetSize);
+                for (UINT i = 0; i < metaData.size(); i++) {
+                    char *ptr = &dataToSend[rankIndex][i * packetSize];
+                    memcpy(ptr, &metaData[i].gSide, sizeof(UINT));
+                    ptr += sizeof(UINT);
+                    memcpy(ptr, &metaData[i].angle, sizeof(UINT));
+                    ptr += sizeof(UINT);
+                    memcpy(ptr, sweepData.getData(metaData[i].cell, 
+                                                  metaData[i].face, 
+                                                  metaData[i].angle), 
+                           dataSize);
+                }
+                
+                int tag = 0;
+                int adjRank = c_adjRanks[rankIndex];
+                mpiError = MPI_Isend(dataToSend[rankIndex].data(), 
+                                     dataToSend[rankIndex].size(), 
+                                     MPI_BYTE, adjRank, tag, MPI_COMM_WORLD, 
+                                     &mpiSendRequests[rankIndex]);
+                Insist(mpiError == MPI_SUCCESS, "");
+            }
+            else {
+                mpiSendRequests[rankIndex] = MPI_REQUEST_NULL;
+            }
+        }
+        
+        for (UINT numWaits = 0; numWaits < numToRecv; numWaits++) {
+            
+            int rankIndex;
+            mpiError = MPI_Waitany(mpiRecvRequests.size(), 
+                                   mpiRecvRequests.data(), 
+                                   &rankIndex, MPI_STATUS_IGNORE);
+            Insist(mpiError == MPI_SUCCESS, "");
+            
+            UINT numPackets = dataToRecv[rankIndex].size() / packetSize;
+            for (UINT i = 0; i < numPackets; i++) {
+                char *ptr = &dataToRecv[rankIndex][i * packetSize];
+                UINT gSide;
+                UINT angle;
+                memcpy(&gSide, ptr, sizeof(UINT));
+                ptr += sizeof(UINT);
+                memcpy(&angle, ptr, sizeof(UINT));
+                ptr += sizeof(UINT);
+                
+                UINT side = g_tychoMesh->getGLSide(gSide);
+                sweepData.setSideData(side, angle, ptr);
+            }
+        }
+        
+        if (numAdjRanks > 0) {
+            mpiError = MPI_Waitall(mpiSendRequests.size(), 
+                                   mpiSendRequests.data(), 
+                                   MPI_STATUSES_IGNORE);
+            Insist(mpiError == MPI_SUCCESS, "");
+        }
+        commTimer.stop();
+    }
+    totalTimer.stop();
+    
+    
+    // Print times
+    double totalTime = totalTimer.wall_clock();
+    Comm::gmax(totalTime);
+    
+    double computeTime = computeTimer.sum_wall_clock();
+    Comm::gmax(computeTime);
+    
+    double commTime = commTimer.sum_wall_clock();
+    Comm::gmax(commTime);
+    
+    if (Comm::rank() == 0) {
+        printf("      Level Sweep Timer (compute): %fs\n", computeTime);
+        printf("      Level Sweep Timer (comm):    %fs\n", commTime);
+        printf("      Level Sweep Timer (total):   %fs\n", totalTime);
+    }
+}
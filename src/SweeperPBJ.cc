@@ -120,6 +120,7 @@ void SweeperPBJOuter::solve()
             printf(" %" PRIu64, sourceIts[i]);
         printf("\n");
     }
+    c_commSides.printStats();
 }
 
 
@@ -159,6 +160,7 @@ void SweeperPBJ::solve()
     if (Comm::rank() == 0) {
         printf("Num source iters: %" PRIu64 "\n", c_iters);
     }
+    c_commSides.printStats();
 }
 
 
@@ -247,9 +249,8 @@ void SweeperPBJSI::solve()
     while (iter < g_ddIterMax) {
         
         Util::calcTotalSource(c_source, phi0, totalSource);
-        sweep(c_psi, totalSource, false);
+        Util::sweepLocal(c_psi, totalSource, c_psiBound, c_commSides);
         Util::psiToPhi(phi1, c_psi);
-        c_commSides.commSides(c_psi, c_psiBound);
         
 
         // Check tolerance and set phi0 = phi1
@@ -285,6 +286,7 @@ void SweeperPBJSI::solve()
             printf(" %" PRIu64, sourceIts[i]);
         printf("\n");
     }
+    c_commSides.printStats();
 }
 
 
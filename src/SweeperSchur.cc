@@ -196,8 +196,8 @@ void Schur(const double *x, double *b, void *voidData)
 
 
     // Perform W L_I^{-1} L_B
-    Util::sweepLocal(*data->psi, *data->source, *data->psiBound);
-    data->commSides->commSides(*data->psi, *data->psiBound);
+    Util::sweepLocal(*data->psi, *data->source, *data->psiBound, 
+                     *data->commSides);
 
     
     // psiBound -> b
@@ -280,9 +280,7 @@ void SweeperSchur::sweep(PsiData &psi, const PsiData &source, bool zeroPsiBound)
         printf("      Schur: Set RHS\n");
     }
     psiBound.setToValue(0.0);
-    Util::sweepLocal(psi, source, psiBound);
-
-    c_commSides.commSides(psi, psiBound);
+    Util::sweepLocal(psi, source, psiBound, c_commSides);
     b = c_krylovSolver->getB();
     psiBoundToVec(b, psiBound);
     c_krylovSolver->releaseB();
@@ -507,8 +505,7 @@ void SchurKrylov(const double *x, double *b, void *voidData)
 
 
     // Perform most of the operator
-    Util::sweepLocal(psi, source, psiBound);
-    commSides.commSides(psi, psiBound);
+    Util::sweepLocal(psi, source, psiBound, commSides);
     Util::psiToPhi(phi, psi);
 
     
@@ -56,18 +56,50 @@ SweeperTraverse::SweeperTraverse()
 {
     c_priorities.resize(g_nCells, g_nAngles);
     Priorities::calcPriorities(c_priorities);
+    c_multiGraphTraverser = NULL;
+    c_multiNumSources = 0;
+}
+
+
+/*
+    SweeperTraverse destructor
+*/
+SweeperTraverse::~SweeperTraverse()
+{
+    delete c_multiGraphTraverser;
 }
 
 
 /*
     solve
+    
+    If g_nSources > 1, solves for sources (i+1) * Q, i = 0...g_nSources-1,
+    with one traversal per sweep.  psi is kept for the first source.
 */
 void SweeperTraverse::solve()
 {
     Problem::getSource(c_source);
     c_psi.setToValue(0.0);
 
-    if (g_useSourceIteration)
+    if (g_nSources > 1) {
+        Insist(g_useSourceIteration, 
+               "NumSources > 1 requires SourceIteration true.");
+        
+        vector<PsiData> psi(g_nSources);
+        vector<PsiData> source(g_nSources);
+        for (UINT i = 0; i < g_nSources; i++) {
+            for (UINT j = 0; j < c_source.size(); j++) {
+                source[i][j] = (i + 1) * c_source[j];
+            }
+        }
+        
+        SourceIteration::fixedPoint(*this, psi, source);
+        
+        for (UINT j = 0; j < c_psi.size(); j++) {
+            c_psi[j] = psi[0][j];
+        }
+    }
+    else if (g_useSourceIteration)
         SourceIteration::fixedPoint(*this, c_psi, c_source);
     else
         SourceIteration::krylov(*this, c_psi, c_source);
@@ -84,7 +116,38 @@ void SweeperTraverse::sweep(PsiData &psi, const PsiData &source,
 {
     UNUSED_VARIABLE(zeroPsiBound);
     PsiBoundData psiBound;
-    SweepData sweepData(psi, source, psiBound, c_priorities);
+    SweepData sweepData(psi, source, psiBound, c_priorities, g_nGroupBlocks);
     g_graphTraverserForward->traverse(g_maxCellsPerStep, sweepData);
 }
 
+
+/*
+    SweeperTraverse::sweepMulti
+    
+    Sweep several (psi, source) pairs in one traversal.
+    The dependencies, priorities and messages are shared by all the pairs.
+*/
+void SweeperTraverse::sweepMulti(vector<PsiData> &psi, 
+                                 const vector<PsiData> &source)
+{
+    Assert(psi.size() == source.size());
+    UINT numSources = psi.size();
+    
+    
+    // Packets hold data for all the sources, so the traverser depends on
+    // the number of sources
+    if (c_multiNumSources != numSources) {
+        delete c_multiGraphTraverser;
+        c_multiGraphTraverser = 
+            new GraphTraverser(Direction_Forward, true, 
+                MultiSweepData::getDataSizeInBytes(numSources, g_nGroupBlocks),
+                g_nGroupBlocks);
+        c_multiNumSources = numSources;
+    }
+    
+    vector<PsiBoundData> psiBound(numSources);
+    MultiSweepData sweepData(psi, source, psiBound, c_priorities, 
+                             g_nGroupBlocks);
+    c_multiGraphTraverser->traverse(g_maxCellsPerStep, sweepData);
+}
+
@@ -44,17 +44,24 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "PsiData.hh"
 #include "Global.hh"
 #include "SweeperAbstract.hh"
+#include "GraphTraverser.hh"
+#include <vector>
 
 
 class SweeperTraverse : public SweeperAbstract
 {
 public:
     SweeperTraverse();
+    ~SweeperTraverse();
     void sweep(PsiData &psi, const PsiData &source, bool zeroPsiBound);
+    void sweepMulti(std::vector<PsiData> &psi, 
+                    const std::vector<PsiData> &source);
     void solve();
 
 private:
     Mat2<UINT> c_priorities;
+    GraphTraverser *c_multiGraphTraverser;
+    UINT c_multiNumSources;
 };
 
 #endif
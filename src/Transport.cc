@@ -687,6 +687,20 @@ namespace Transport
 void solve(const UINT cell, const UINT angle, const double sigmaTotal,
            const Mat3<double> &localPsiBound, const Mat2<double> &localSource,
            Mat2<double> &localPsi)
+{
+    solve(cell, angle, sigmaTotal, localPsiBound, localSource, localPsi,
+          0, g_nGroups);
+}
+
+
+/*
+    solve
+    
+    Only solves for groups in [groupBegin, groupEnd).
+*/
+void solve(const UINT cell, const UINT angle, const double sigmaTotal,
+           const Mat3<double> &localPsiBound, const Mat2<double> &localSource,
+           Mat2<double> &localPsi, const UINT groupBegin, const UINT groupEnd)
 {
     double volume, area[g_nFacePerCell];
 
@@ -705,7 +719,7 @@ void solve(const UINT cell, const UINT angle, const double sigmaTotal,
     
     
     // Solve local transport problem for each group
-    for (UINT group = 0; group < g_nGroups; group++) {
+    for (UINT group = groupBegin; group < groupEnd; group++) {
         
         double cellSource[g_nVrtxPerCell] = {0.0};
         double matrix[g_nVrtxPerCell][g_nVrtxPerCell] = {0.0};
@@ -741,6 +755,22 @@ void populateLocalPsiBound(const UINT angle, const UINT cell,
                            const PsiData &__restrict psi, 
                            const PsiBoundData & __restrict psiBound,
                            Mat3<double> &__restrict localPsiBound)
+{
+    populateLocalPsiBound(angle, cell, psi, psiBound, localPsiBound, 
+                          0, g_nGroups);
+}
+
+
+/*
+    populateLocalPsiBound
+    
+    Only populates groups in [groupBegin, groupEnd).
+*/
+void populateLocalPsiBound(const UINT angle, const UINT cell, 
+                           const PsiData &__restrict psi, 
+                           const PsiBoundData & __restrict psiBound,
+                           Mat3<double> &__restrict localPsiBound,
+                           const UINT groupBegin, const UINT groupEnd)
 {
     // Default to 0.0
     for (UINT i = 0; i < localPsiBound.size(); i++)
@@ -748,7 +778,7 @@ void populateLocalPsiBound(const UINT angle, const UINT cell,
     
     // Populate if incoming flux
     #pragma omp simd
-    for (UINT group = 0; group < g_nGroups; group++) {
+    for (UINT group = groupBegin; group < groupEnd; group++) {
     for (UINT face = 0; face < g_nFacePerCell; face++) {
         if (g_tychoMesh->isIncoming(angle, cell, face)) {
             UINT neighborCell = g_tychoMesh->getAdjCell(cell, face);
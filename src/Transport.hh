@@ -52,10 +52,22 @@ namespace Transport
                const Mat3<double> &localPsiBound, 
                const Mat2<double> &localSource,
                Mat2<double> &localPsi);
+    
+    void solve(const UINT cell, const UINT angle, 
+               const double sigmaTotal,
+               const Mat3<double> &localPsiBound, 
+               const Mat2<double> &localSource,
+               Mat2<double> &localPsi,
+               const UINT groupBegin, const UINT groupEnd);
 
     void populateLocalPsiBound(const UINT angle, const UINT cell, 
                                const PsiData &psi, const PsiBoundData &psiBound,
                                Mat3<double> &localPsiBound);
+    
+    void populateLocalPsiBound(const UINT angle, const UINT cell, 
+                               const PsiData &psi, const PsiBoundData &psiBound,
+                               Mat3<double> &localPsiBound,
+                               const UINT groupBegin, const UINT groupEnd);
 } // End namespace Transport
 
 #endif
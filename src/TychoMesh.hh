@@ -56,7 +56,9 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Mat.hh"
 #include "Global.hh"
 #include "Assert.hh"
-#include <map>
+#include <vector>
+#include <utility>
+#include <algorithm>
 
 
 class TychoMesh 
@@ -86,7 +88,10 @@ public:
     UINT getLGSide(const UINT side) const
         { return c_lGSides(side); }
     UINT getGLSide(const UINT side) const
-        { return c_gLSides.find(side)->second; }
+        { auto it = std::lower_bound(c_gLSides.begin(), c_gLSides.end(), 
+                                     std::make_pair(side, (UINT)0));
+          Assert(it != c_gLSides.end() && it->first == side);
+          return it->second; }
     UINT getLGCell(const UINT cell) const
         { return c_lGCells(cell); }
     UINT getAdjRank(const UINT cell, const UINT face) const
@@ -149,7 +154,8 @@ private:
     Mat2<UINT> c_side;              // (cell, face) -> side
     Mat1<UINT> c_lGSides;           // local to global side numbering.
     Mat1<UINT> c_lGCells;           // local to global side numbering.
-    std::map<UINT, UINT> c_gLSides; // global to local side numbering.
+    std::vector<std::pair<UINT,UINT>> c_gLSides; // global to local side 
+                                                 // numbering (sorted).
     Mat2<UINT> c_adjProc;           // (cell, face) -> adjacent proc
     Mat3<double> c_omegaDotN;       // (angle, cell, face) -> omega dot n
     Mat1<double> c_cellVolume;      // cell -> volume
@@ -46,6 +46,7 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <memory>
 #include <stddef.h>
 #include <utility>
+#include <algorithm>
 
 using namespace std;
 
@@ -240,13 +241,14 @@ void TychoMesh::readTychoMesh(const std::string &filename)
             c_sideCell(side) = cell;
             c_side(cell, lface) = side;
             c_lGSides(side) = gside;
-            c_gLSides.insert(make_pair(gside, side));
+            c_gLSides.push_back(make_pair(gside, side));
             side++;
         }
         else {
             c_side(cell, lface) = NOT_BOUNDARY_FACE;
         }
     }}
+    sort(c_gLSides.begin(), c_gLSides.end());
     
     
     // c_adjProc
@@ -145,6 +145,25 @@ void sweepLocal(PsiData &psi, const PsiData &source, PsiBoundData &psiBound)
 }
 
 
+/*
+    sweepLocal
+    
+    Solves L_I Psi = L_B Psi_B + Q and then does commSides.commSides(psi, 
+    psiBound).  Outgoing boundary psi is sent while the sweep runs.
+*/
+void sweepLocal(PsiData &psi, const PsiData &source, PsiBoundData &psiBound,
+                CommSides &commSides)
+{
+    Mat2<UINT> priorities(g_nCells, g_nAngles);
+    const UINT maxComputePerStep = std::numeric_limits<uint64_t>::max();
+    SweepData sweepData(psi, source, psiBound, priorities, 1, &commSides);
+    
+    commSides.startSides();
+    g_graphTraverserForward->traverse(maxComputePerStep, sweepData);
+    commSides.finishSides(psi, psiBound);
+}
+
+
 /*
     operatorS
 */
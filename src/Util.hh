@@ -43,6 +43,8 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "PsiData.hh"
 
+class CommSides;
+
 namespace Util
 {
 
@@ -52,6 +54,8 @@ void phiToPsi(const PhiData &phi, PsiData &psi);
 void calcTotalSource(const PsiData &source, const PhiData &phi, 
                      PsiData &totalSource);
 void sweepLocal(PsiData &psi, const PsiData &source, PsiBoundData &psiBound);
+void sweepLocal(PsiData &psi, const PsiData &source, PsiBoundData &psiBound,
+                CommSides &commSides);
 void operatorS(const PhiData &phi1, PhiData &phi2);
 
 } // End namespace
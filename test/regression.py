@@ -4,6 +4,16 @@ import subprocess
 tolerance = "1e-10"
 
 
+# Tolerance for a run script
+# A script can set its own with a line TOLERANCE="<value>", e.g. when psi
+# is rounded to single precision between ranks.
+def getTolerance(name):
+    for line in open(name):
+        if line.startswith("TOLERANCE="):
+            return line.split("=")[1].strip().strip('"')
+    return tolerance
+
+
 # Print what we're doing
 print " "
 print "--- Running Regression Tests ---"
@@ -33,7 +43,7 @@ for s in output1:
     
     print "Test", s
     subprocess.check_output(["sh", name, ">", name2])
-    status = subprocess.call(["python", "diff.py", "regression/gold.psi", "out.psi", tolerance])
+    status = subprocess.call(["python", "diff.py", "regression/gold.psi", "out.psi", getTolerance(name)])
     if status == 0:
         print "                                                       Pass"
         print " "
@@ -0,0 +1,16 @@
+
+
+NX=2
+NY=2
+NUM_PARTS=$((NX*NY))
+IN_FILE="cube-208.smesh"
+OUT_FILE="temp.pmesh"
+INPUT_DECK="regression/input-scheduleCacheOrig2.deck"
+export OMP_NUM_THREADS=3
+
+./PartitionColumns.x $NX $NY $IN_FILE $OUT_FILE
+# First run writes the schedule cache, second run reads it
+mpirun -n $NUM_PARTS ./sweep.x $OUT_FILE $INPUT_DECK
+mpirun -n $NUM_PARTS ./sweep.x $OUT_FILE $INPUT_DECK
+rm temp.cache.*
+rm $OUT_FILE